@@ -28,7 +28,8 @@ SET LIBS=kernel32.lib ^
 	SDL2main.lib ^
 	opengl32.lib
 
-SET ASSET_ARCHIVE=bin\assets.zip
+SET ASSET_ARCHIVE=bin\assets.pak
+SET PACKER=%BIN_DIR%\packer.exe
 SET zip=utilities\7z.exe
 
 taskkill /IM %BASE_NAME%.exe >NUL 2>&1
@@ -129,12 +130,14 @@ del *.obj
 
 :DEPENDENCIES
 copy %SHARED_PATH%\*.dll %BIN_DIR% 1>NUL 2>&1
-del %ASSET_ARCHIVE%
-%zip% a %ASSET_ARCHIVE% src\shaders\*.glsl 1>NUL
-%zip% a %ASSET_ARCHIVE% assets\*.png 1>NUL
-%zip% a %ASSET_ARCHIVE% assets\*.wav 1>NUL
-%zip% a %ASSET_ARCHIVE% assets\*.ogg 1>NUL
-%zip% a %ASSET_ARCHIVE% assets\*.flac 1>NUL
+cl /nologo /TC /O2 /W3 /MT %DISABLED_WARNINGS% src\packer.c /DWB_WINDOWS /Fe%PACKER% /link /NOLOGO /INCREMENTAL:NO 1>NUL
+del packer.obj
+
+REM Asset names are the paths as given here, see src\packer.c
+SET PACK_FILES=
+for %%f in (src\shaders\*.glsl assets\*.png assets\*.wav assets\*.ogg assets\*.flac) do call set PACK_FILES=%%PACK_FILES%% %%f
+del %ASSET_ARCHIVE% 1>NUL 2>&1
+%PACKER% %ASSET_ARCHIVE% %PACK_FILES% 1>NUL
 
 
 
@@ -153,9 +156,9 @@ GOTO END
 :PUBLISH
 SET PUBLISH_ARCHIVE=..\%BASE_NAME%.zip
 pushd bin
-..\%zip% a %PUBLISH_ARCHIVE% *.exe 1>NUL 
+..\%zip% a %PUBLISH_ARCHIVE% %BASE_NAME%.exe 1>NUL 
 ..\%zip% a %PUBLISH_ARCHIVE% *.dll 1>NUL 
-..\%zip% a %PUBLISH_ARCHIVE% *.zip 1>NUL 
+..\%zip% a %PUBLISH_ARCHIVE% *.pak 1>NUL 
 popd
 
 GOTO END
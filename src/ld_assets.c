@@ -0,0 +1,274 @@
+
+/* Asset packs
+ *
+ * A pack is built offline by packer.c and memory-mapped at startup.
+ * Layout (all offsets from the start of the file):
+ *
+ *	AssetPackHeader
+ *	u32 slots[slot_count]          -- open addressed, entry index + 1, 0 is empty
+ *	AssetPackEntry entries[entry_count]
+ *	char names[]                   -- null terminated, referenced by name_offset
+ *	data                           -- each entry aligned to AssetPackAlignment,
+ *	                                  followed by a zero byte
+ *
+ * Stored entries are handed out as pointers straight into the mapping.
+ * Compressed entries (zlib) are inflated the first time they're asked for,
+ * into an arena owned by the pack, and that copy is returned from then on.
+ * Either way the caller never frees what asset_pack_get gives back.
+ *
+ * The packer only needs the layout, so it defines WB_PACKER and gets
+ * everything up to the reader, which uses SDL's atomics.
+ */
+
+#define AssetPackMagic 0x4B415057 //"WPAK"
+#define AssetPackVersion 1
+#define AssetPackAlignment 64
+
+#define FNV64_Basis UINT64_C(0xCBF29CE484222325)
+#define FNV64_Prime UINT64_C(0x100000001B3)
+
+static inline
+u64 hash_fnv64(const void* data, isize size, u64 hash)
+{
+	const u8* p = data;
+	for(isize i = 0; i < size; ++i) {
+		hash ^= p[i];
+		hash *= FNV64_Prime;
+	}
+	return hash;
+}
+
+static inline
+u64 hash_string(string s)
+{
+	return hash_fnv64(s, strlen(s), FNV64_Basis);
+}
+
+typedef enum AssetPackFlags_
+{
+	AssetFlag_Compressed = Flag(0)
+} AssetPackFlags;
+
+typedef struct AssetPackHeader_
+{
+	u32 magic;
+	u32 version;
+	u32 entry_count;
+	u32 slot_count;
+	u64 slots_offset;
+	u64 entries_offset;
+	u64 names_offset;
+	u64 data_offset;
+} AssetPackHeader;
+
+typedef struct AssetPackEntry_
+{
+	u64 hash;
+	u64 offset;
+	u64 size;
+	u64 stored_size;
+	u32 name_offset;
+	u32 flags;
+} AssetPackEntry;
+
+#ifndef WB_PACKER
+
+typedef enum AssetInflateState_
+{
+	AssetInflate_NotStarted,
+	AssetInflate_Inflating,
+	AssetInflate_Done,
+	AssetInflate_Failed
+} AssetInflateState;
+
+typedef struct AssetPack_
+{
+	string name;
+	u8* data;
+	isize size;
+
+	AssetPackHeader* header;
+	u32* slots;
+	AssetPackEntry* entries;
+	char* names;
+
+	//Where compressed entries get inflated to, and an AssetInflateState for each
+	void** inflated;
+	SDL_atomic_t* inflate_state;
+	MemoryArena* arena;
+} AssetPack;
+
+static inline
+isize asset_pack_probe(AssetPack* pack, string name, u64 hash)
+{
+	u32 mask = pack->header->slot_count - 1;
+	u32 slot = (u32)hash & mask;
+	for(u32 i = 0; i < pack->header->slot_count; ++i) {
+		u32 index = pack->slots[slot];
+		if(index == 0) {
+			return -1;
+		}
+		AssetPackEntry* entry = pack->entries + (index - 1);
+		if(entry->hash == hash && strcmp(pack->names + entry->name_offset, name) == 0) {
+			return index - 1;
+		}
+		slot = (slot + 1) & mask;
+	}
+	return -1;
+}
+
+//Whether [offset, offset + size) is inside the pack, without overflowing
+static inline
+i32 asset_pack_in_bounds(u64 pack_size, u64 offset, u64 size)
+{
+	return offset <= pack_size && size <= pack_size - offset;
+}
+
+//Checks everything asset_pack_get will ever read is inside the mapping, so a
+//truncated or corrupt pack is turned away here rather than read past the end
+static
+i32 asset_pack_validate(AssetPack* pack)
+{
+	u64 size = (u64)pack->size;
+	if(size < sizeof(AssetPackHeader)) return false;
+	AssetPackHeader* header = (AssetPackHeader*)pack->data;
+	if(header->magic != AssetPackMagic || header->version != AssetPackVersion) return false;
+	if(header->slot_count == 0 || (header->slot_count & (header->slot_count - 1)) != 0) return false;
+	if(!asset_pack_in_bounds(size, header->slots_offset, (u64)header->slot_count * sizeof(u32)) ||
+			!asset_pack_in_bounds(size, header->entries_offset, (u64)header->entry_count * sizeof(AssetPackEntry)) ||
+			header->names_offset > size ||
+			header->data_offset > size) {
+		return false;
+	}
+
+	u32* slots = (u32*)(pack->data + header->slots_offset);
+	for(u32 i = 0; i < header->slot_count; ++i) {
+		if(slots[i] > header->entry_count) return false;
+	}
+
+	AssetPackEntry* entries = (AssetPackEntry*)(pack->data + header->entries_offset);
+	for(u32 i = 0; i < header->entry_count; ++i) {
+		AssetPackEntry* entry = entries + i;
+		//The name has to end before the pack does
+		u64 name = header->names_offset + entry->name_offset;
+		if(name >= size || memchr(pack->data + name, '\0', size - name) == NULL) return false;
+		if(HasFlag(entry->flags, AssetFlag_Compressed)) {
+			if(!asset_pack_in_bounds(size, entry->offset, entry->stored_size)) return false;
+		} else {
+			//Stored data is handed out as is, zero byte after it included
+			if(entry->size == UINT64_MAX || !asset_pack_in_bounds(size, entry->offset, entry->size + 1)) return false;
+		}
+	}
+	return true;
+}
+
+i32 asset_pack_open(AssetPack* pack, string filename)
+{
+	memset(pack, 0, sizeof(AssetPack));
+	pack->name = filename;
+	pack->data = platform_map_file(filename, &pack->size);
+	if(pack->data == NULL) {
+		log_error("Error: could not map asset pack %s", filename);
+		return false;
+	}
+
+	if(!asset_pack_validate(pack)) {
+		log_error("Error: %s is not a valid asset pack", filename);
+		platform_unmap_file(pack->data, pack->size);
+		pack->data = NULL;
+		return false;
+	}
+
+	AssetPackHeader* header = (AssetPackHeader*)pack->data;
+	pack->header = header;
+	pack->slots = (u32*)(pack->data + header->slots_offset);
+	pack->entries = (AssetPackEntry*)(pack->data + header->entries_offset);
+	pack->names = (char*)(pack->data + header->names_offset);
+
+	//Everything that could ever be inflated is known up front, so each
+	//compressed entry gets its own spot in the arena here. asset_pack_get
+	//never allocates, which lets the streaming workers call it for
+	//different entries at the same time.
+	isize inflated_size = (sizeof(void*) + sizeof(SDL_atomic_t)) * header->entry_count + 8;
+	for(u32 i = 0; i < header->entry_count; ++i) {
+		AssetPackEntry* entry = pack->entries + i;
+		if(HasFlag(entry->flags, AssetFlag_Compressed)) {
+			inflated_size += mem_align(entry->size + 1, 4);
+		}
+	}
+	pack->arena = arena_bootstrap("AssetArena", inflated_size);
+	pack->inflated = arena_push(pack->arena, sizeof(void*) * header->entry_count);
+	pack->inflate_state = arena_push(pack->arena, sizeof(SDL_atomic_t) * header->entry_count);
+	for(u32 i = 0; i < header->entry_count; ++i) {
+		AssetPackEntry* entry = pack->entries + i;
+		pack->inflated[i] = NULL;
+		SDL_AtomicSet(pack->inflate_state + i, AssetInflate_NotStarted);
+		if(HasFlag(entry->flags, AssetFlag_Compressed)) {
+			pack->inflated[i] = arena_push(pack->arena, entry->size + 1);
+		}
+	}
+
+	return true;
+}
+
+void asset_pack_close(AssetPack* pack)
+{
+	if(pack->data == NULL) return;
+	platform_unmap_file(pack->data, pack->size);
+	arena_free(pack->arena);
+	pack->data = NULL;
+	pack->arena = NULL;
+	pack->inflated = NULL;
+	pack->inflate_state = NULL;
+}
+
+//Returns a borrowed pointer, valid until asset_pack_close.
+//Data is always followed by a zero byte, so text assets can be used as strings
+//Safe to call from any thread. If several want the same compressed asset at
+//once, the first one inflates it and the rest wait for it to finish.
+void* asset_pack_get(AssetPack* pack, string name, isize* size_out)
+{
+	isize index = asset_pack_probe(pack, name, hash_string(name));
+	if(index == -1) {
+		log_error("Error: asset %s not found in %s", name, pack->name);
+		if(size_out != NULL) *size_out = 0;
+		return NULL;
+	}
+
+	AssetPackEntry* entry = pack->entries + index;
+	void* data = pack->data + entry->offset;
+	if(HasFlag(entry->flags, AssetFlag_Compressed)) {
+		SDL_atomic_t* state = pack->inflate_state + index;
+		if(SDL_AtomicCAS(state, AssetInflate_NotStarted, AssetInflate_Inflating)) {
+			u8* out = pack->inflated[index];
+			usize len = tinfl_decompress_mem_to_mem(out, entry->size,
+					data, entry->stored_size,
+					TINFL_FLAG_PARSE_ZLIB_HEADER);
+			if(len == entry->size) {
+				out[entry->size] = '\0';
+				SDL_AtomicSet(state, AssetInflate_Done);
+			} else {
+				SDL_AtomicSet(state, AssetInflate_Failed);
+			}
+		} else {
+			while(SDL_AtomicGet(state) == AssetInflate_Inflating) {
+				SDL_Delay(0);
+			}
+		}
+
+		if(SDL_AtomicGet(state) != AssetInflate_Done) {
+			log_error("Error: asset %s in %s is corrupt", name, pack->name);
+			if(size_out != NULL) *size_out = 0;
+			return NULL;
+		}
+		data = pack->inflated[index];
+	}
+
+	if(size_out != NULL) {
+		*size_out = entry->size;
+	}
+	return data;
+}
+
+#endif
+
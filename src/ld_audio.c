@@ -1,73 +1,729 @@
 
 SDL_AudioDeviceID audio_device = 0;
-sts_mixer_t mixer;
-
-short* decoded;
-u8* audio_pos;
-
-#define USE_VORBIS
+Mixer mixer;
 
 typedef f32 AudioType;
 int AudioForSDL = AUDIO_F32SYS;
-int AudioForSTS = STS_MIXER_SAMPLE_FORMAT_FLOAT;
 
-typedef struct AudioStream_
+#define AudioSampleRate 44100
+#define AudioChannels 2
+#define AudioCallbackFrames 1024
+
+/* Single producer, single consumer ring of stereo float frames.
+ *
+ * The decoder thread only ever moves write, the audio callback only ever
+ * moves read; both are free running and wrap through the mask. SDL_AtomicSet
+ * is a full barrier, so frames are written before the new write index is
+ * published, and read before the new read index frees their space.
+ */
+typedef struct AudioRing_
+{
+	f32* data;
+	u32 capacity;
+	u32 mask;
+	SDL_atomic_t read;
+	SDL_atomic_t write;
+} AudioRing;
+
+//capacity is in frames and must be a power of two
+void audio_ring_init(AudioRing* ring, f32* data, u32 capacity)
+{
+	ring->data = data;
+	ring->capacity = capacity;
+	ring->mask = capacity - 1;
+	SDL_AtomicSet(&ring->read, 0);
+	SDL_AtomicSet(&ring->write, 0);
+}
+
+static inline
+u32 audio_ring_available(AudioRing* ring)
+{
+	return (u32)SDL_AtomicGet(&ring->write) - (u32)SDL_AtomicGet(&ring->read);
+}
+
+static inline
+u32 audio_ring_free(AudioRing* ring)
+{
+	return ring->capacity - audio_ring_available(ring);
+}
+
+//Producer side; returns how many frames actually fit
+u32 audio_ring_push(AudioRing* ring, const f32* frames, u32 count)
+{
+	u32 write = SDL_AtomicGet(&ring->write);
+	u32 space = ring->capacity - (write - (u32)SDL_AtomicGet(&ring->read));
+	if(count > space) count = space;
+	for(u32 i = 0; i < count; ++i) {
+		u32 index = ((write + i) & ring->mask) * AudioChannels;
+		ring->data[index] = frames[i * AudioChannels];
+		ring->data[index + 1] = frames[i * AudioChannels + 1];
+	}
+	SDL_AtomicSet(&ring->write, write + count);
+	return count;
+}
+
+//Consumer side; adds up to count frames into out, scaled by gain
+u32 audio_ring_mix(AudioRing* ring, f32* out, u32 count, f32 gain)
+{
+	u32 read = SDL_AtomicGet(&ring->read);
+	u32 available = (u32)SDL_AtomicGet(&ring->write) - read;
+	if(count > available) count = available;
+	for(u32 i = 0; i < count; ++i) {
+		u32 index = ((read + i) & ring->mask) * AudioChannels;
+		out[i * AudioChannels] += ring->data[index] * gain;
+		out[i * AudioChannels + 1] += ring->data[index + 1] * gain;
+	}
+	SDL_AtomicSet(&ring->read, read + count);
+	return count;
+}
+
+/* Audio commands
+ *
+ * The game thread never touches the mixer or takes the device lock. Anything
+ * that changes what the callback is doing -- starting and stopping sounds,
+ * gain, pan, fades, music -- goes through a single producer, single consumer
+ * ring of commands, drained at the top of the callback before it mixes. Same
+ * publishing rules as AudioRing: fill the slot, then move the index with
+ * SDL_AtomicSet. If the ring is full the command is dropped rather than
+ * waiting on the audio thread. Without a device nothing drains it, so the
+ * queue is shut and every command is dropped.
+ *
+ * Sounds are referred to by handles handed out on the game thread when they
+ * start, so stop/gain/pan/fade can be sent straight away without waiting to
+ * hear which voice the audio thread picked. A handle whose sound has already
+ * finished is ignored.
+ */
+#define AudioCommandCapacity 256
+
+typedef u32 SoundHandle;
+
+typedef enum AudioCommandKind_
+{
+	AudioCommand_Play,
+	AudioCommand_Stop,
+	AudioCommand_SetGain,
+	AudioCommand_SetPan,
+	AudioCommand_Fade,
+	AudioCommand_MasterGain,
+	AudioCommand_MusicStart,
+	AudioCommand_MusicStop,
+	AudioCommand_MusicGain
+} AudioCommandKind;
+
+typedef struct AudioCommand_
+{
+	AudioCommandKind kind;
+	SoundHandle handle;
+	i32 sound;
+	f32 gain;
+	f32 pan;
+	f32 pitch;
+	//Fade length in frames, or for MusicStop, the ring's write index
+	u32 frames;
+} AudioCommand;
+
+typedef struct AudioCommandQueue_
+{
+	AudioCommand commands[AudioCommandCapacity];
+	SDL_atomic_t read;
+	SDL_atomic_t write;
+	u32 dropped;
+
+	//Game thread only
+	i32 open;
+	SoundHandle next_handle;
+	//Audio thread only; the handle each mixer voice was started with, in
+	//voice order, not sorted
+	SoundHandle voice_handles[MixerMaxVoices];
+} AudioCommandQueue;
+
+AudioCommandQueue audio_commands;
+
+static
+i32 audio_command_push(AudioCommandQueue* queue, AudioCommand* command)
+{
+	if(!queue->open) return false;
+	u32 write = SDL_AtomicGet(&queue->write);
+	if(write - (u32)SDL_AtomicGet(&queue->read) >= AudioCommandCapacity) {
+		queue->dropped++;
+		return false;
+	}
+	queue->commands[write & (AudioCommandCapacity - 1)] = *command;
+	SDL_AtomicSet(&queue->write, write + 1);
+	return true;
+}
+
+static
+void audio_command_send(AudioCommandKind kind, SoundHandle handle, f32 gain, u32 frames)
+{
+	AudioCommand command;
+	memset(&command, 0, sizeof(AudioCommand));
+	command.kind = kind;
+	command.handle = handle;
+	command.gain = gain;
+	command.frames = frames;
+	audio_command_push(&audio_commands, &command);
+}
+
+/* Streaming music
+ *
+ * Music is decoded on its own thread, never the audio thread. The decoder
+ * keeps MusicRingFrames (~0.75s) of audio buffered ahead of the callback,
+ * which just copies out of the ring. Sources are borrowed from the asset pack
+ * and can be ogg vorbis, flac or wav; the format is picked by magic number.
+ * Files that aren't at the device rate are resampled on the decoder thread
+ * too, before they go in the ring.
+ */
+#define MusicRingFrames 32768
+#define MusicDecodeFrames 2048
+//Largest device rate / file rate we resample, eg 8kHz up to 48kHz is 6
+#define MusicMaxUpsample 8
+#define MusicResampleWindow (MusicDecodeFrames + 16)
+
+typedef enum MusicSourceKind_
+{
+	MusicSource_None,
+	MusicSource_Vorbis,
+	MusicSource_Flac,
+	MusicSource_Wav
+} MusicSourceKind;
+
+typedef struct MusicStream_
 {
+	MusicSourceKind kind;
 	stb_vorbis* vorbis;
-	sts_mixer_stream_t stream;
-	AudioType* data;
-} AudioStream;
+	drflac* flac;
+	drwav* wav;
+	i32 channels;
+	i32 sample_rate;
+	i32 loop;
+
+	AudioRing ring;
+	f32* decode_buffer;
+	i32* decode_buffer_s32;
 
-static void audio_callback(void* user, u8* stream, i32 len) 
+	i32 resampling;
+	ResampleStream resampler;
+	f32* resample_window;
+	f32* resample_buffer;
+
+	SDL_Thread* thread;
+	SDL_atomic_t running;
+	SDL_atomic_t finished;
+
+	//Audio thread only, set by the music commands. A new stream can't start
+	//filling the ring until the callback frees the old one's leftovers, so
+	//there's a short gap that shouldn't count as an underrun.
+	i32 playing;
+	i32 filling;
+	f32 gain;
+} MusicStream;
+
+MusicStream music;
+u32 audio_underruns = 0;
+
+//Decodes up to count frames as interleaved stereo into out; 0 at end of stream
+static
+u32 music_decode(MusicStream* m, f32* out, u32 count)
 {
-	sts_mixer_mix_audio(&mixer, stream, len / (sizeof(AudioType) * 2));
+	u32 frames = 0;
+	switch(m->kind) {
+		case MusicSource_Vorbis:
+			frames = stb_vorbis_get_samples_float_interleaved(m->vorbis, AudioChannels, out, count * AudioChannels);
+			break;
+		case MusicSource_Flac: {
+			u32 samples = drflac_read_s32(m->flac, count * m->channels, m->decode_buffer_s32);
+			frames = samples / m->channels;
+			for(u32 i = 0; i < frames; ++i) {
+				i32* src = m->decode_buffer_s32 + i * m->channels;
+				out[i * 2] = src[0] / 2147483648.0f;
+				out[i * 2 + 1] = src[m->channels > 1 ? 1 : 0] / 2147483648.0f;
+			}
+		} break;
+		case MusicSource_Wav: {
+			u32 samples = drwav_read_f32(m->wav, count * m->channels, m->decode_buffer);
+			frames = samples / m->channels;
+			if(m->channels != AudioChannels) {
+				//decode_buffer is the same memory as out for stereo files only
+				for(u32 i = 0; i < frames; ++i) {
+					f32* src = m->decode_buffer + i * m->channels;
+					out[i * 2] = src[0];
+					out[i * 2 + 1] = src[m->channels > 1 ? 1 : 0];
+				}
+			}
+		} break;
+		default:
+			break;
+	}
+	return frames;
 }
 
-static void refill_stream(sts_mixer_sample_t* sample, void* user) 
+static
+void music_rewind(MusicStream* m)
 {
-	AudioStream* stream = user;
-	//if (drflac_read_s32(stream->flac, sample->length, stream->data) < sample->length) drflac_seek_to_sample(stream->flac, 0);
-	stb_vorbis_get_samples_float_interleaved(stream->vorbis, 2, stream->data, sample->length); 
+	switch(m->kind) {
+		case MusicSource_Vorbis: stb_vorbis_seek_start(m->vorbis); break;
+		case MusicSource_Flac: drflac_seek_to_sample(m->flac, 0); break;
+		case MusicSource_Wav: drwav_seek_to_sample(m->wav, 0); break;
+		default: break;
+	}
 }
 
-void init_audio()
+static
+int music_decoder_proc(void* userdata)
 {
-// Audio code
-/*
-	SDL_AudioSpec want, have;
+	MusicStream* m = userdata;
+	f32* frames = m->decode_buffer;
+	if(m->kind == MusicSource_Wav && m->channels != AudioChannels) {
+		frames = m->decode_buffer + MusicDecodeFrames * 8;
+	}
 
-	want.format = AudioForSDL;
-	want.freq = 44100;
-	want.channels = 2;
-	want.userdata = NULL;
-	want.samples = 4096;
-	want.callback = audio_callback;
-	audio_device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+	//Worst case output for one decoded chunk
+	u32 needed = MusicDecodeFrames;
+	if(m->resampling) {
+		needed = (u32)((u64)MusicDecodeFrames * mixer.sample_rate / m->sample_rate) + 2;
+	}
+
+	while(SDL_AtomicGet(&m->running)) {
+		if(audio_ring_free(&m->ring) < needed) {
+			//A fraction of one callback period; the ring holds dozens of them
+			SDL_Delay(5);
+			continue;
+		}
+
+		u32 count = music_decode(m, frames, MusicDecodeFrames);
+		if(count == 0) {
+			if(m->loop) {
+				music_rewind(m);
+				continue;
+			}
+			SDL_AtomicSet(&m->finished, 1);
+			break;
+		}
+		if(m->resampling) {
+			resample_stream_push(&m->resampler, frames, count);
+			count = resample_stream_pull(&m->resampler, m->resample_buffer, MusicDecodeFrames * MusicMaxUpsample);
+			audio_ring_push(&m->ring, m->resample_buffer, count);
+		} else {
+			audio_ring_push(&m->ring, frames, count);
+		}
+	}
+	return 0;
+}
 
-	sts_mixer_init(&mixer, 44100, AudioForSTS);
+void music_stop()
+{
+	if(music.thread != NULL) {
+		SDL_AtomicSet(&music.running, 0);
+		SDL_WaitThread(music.thread, NULL);
+		music.thread = NULL;
+	}
 
-	AudioStream stream;
-	stb_vorbis_alloc stbvalloc;
-	stbvalloc.alloc_buffer = malloc(Megabytes(8)+64);
-	stbvalloc.alloc_buffer_length_in_bytes = Megabytes(8);
+	//Nothing writes the ring now; the callback skips whatever's left in it,
+	//up to here, when it gets the command
+	audio_command_send(AudioCommand_MusicStop, 0, 0, SDL_AtomicGet(&music.ring.write));
+	music.kind = MusicSource_None;
 
-	int verror = 0;
-	stream.vorbis = stb_vorbis_open_memory(passacaglia, len, &verror, &stbvalloc);
-	stb_vorbis_info vinfo = stb_vorbis_get_info(stream.vorbis);
-	stream.stream.sample.frequency = vinfo.sample_rate;
+	if(music.vorbis) stb_vorbis_close(music.vorbis);
+	if(music.flac) drflac_close(music.flac);
+	if(music.wav) drwav_close(music.wav);
+	music.vorbis = NULL;
+	music.flac = NULL;
+	music.wav = NULL;
+}
 
-	stream.stream.userdata = &stream;
-	stream.stream.callback = refill_stream;
-	stream.stream.sample.audio_format = AudioForSTS;
-	stream.stream.sample.length = 4096 * 2;
-	stream.data = malloc(sizeof(AudioType) * 4096*2);
-	stream.stream.sample.data = stream.data;
+//data must outlive playback (asset pack memory does)
+i32 music_play(void* data, isize size, f32 gain, i32 loop)
+{
+	music_stop();
+	//Nothing would ever empty the ring
+	if(!audio_commands.open) return false;
+	MusicStream* m = &music;
+	MusicSourceKind kind = MusicSource_None;
 
-	refill_stream(&stream.stream.sample, &stream);
+	u8* magic = data;
+	if(size > 4 && memcmp(magic, "OggS", 4) == 0) {
+		i32 error = 0;
+		m->vorbis = stb_vorbis_open_memory(data, size, &error, NULL);
+		if(m->vorbis != NULL) {
+			stb_vorbis_info info = stb_vorbis_get_info(m->vorbis);
+			kind = MusicSource_Vorbis;
+			m->channels = info.channels;
+			m->sample_rate = info.sample_rate;
+		}
+	} else if(size > 4 && memcmp(magic, "fLaC", 4) == 0) {
+		m->flac = drflac_open_memory(data, size);
+		if(m->flac != NULL) {
+			kind = MusicSource_Flac;
+			m->channels = m->flac->channels;
+			m->sample_rate = m->flac->sampleRate;
+		}
+	} else if(size > 4 && memcmp(magic, "RIFF", 4) == 0) {
+		m->wav = drwav_open_memory(data, size);
+		if(m->wav != NULL) {
+			kind = MusicSource_Wav;
+			m->channels = m->wav->channels;
+			m->sample_rate = m->wav->sampleRate;
+		}
+	}
 
-	sts_mixer_play_stream(&mixer, &stream.stream, 0.9f);
-	SDL_PauseAudioDevice(audio_device, 0);
-*/
+	if(kind == MusicSource_None) {
+		log_error("Error: could not open music stream (%d bytes)", (i32)size);
+		return false;
+	}
+	m->resampling = m->sample_rate != (i32)mixer.sample_rate;
+	if(m->resampling && (u32)m->sample_rate * MusicMaxUpsample < mixer.sample_rate) {
+		log_error("Warning: music is %dHz, too far below the device's %dHz to resample", 
+				m->sample_rate, mixer.sample_rate);
+		m->resampling = false;
+	}
+	if(m->resampling) {
+		//Music gets the expensive kernel; it's one stream on its own thread
+		resample_stream_init(&m->resampler, Resample_Sinc, m->sample_rate, mixer.sample_rate,
+				m->resample_window, m->resample_window + MusicResampleWindow, MusicResampleWindow);
+	}
+
+	//The ring carries straight on from the last stream, see music_stop
+	m->kind = kind;
+	m->loop = loop;
+	SDL_AtomicSet(&m->finished, 0);
+	SDL_AtomicSet(&m->running, 1);
+	audio_command_send(AudioCommand_MusicStart, 0, gain, 0);
+	m->thread = SDL_CreateThread(music_decoder_proc, "MusicDecoder", m);
+	return true;
+}
+
+/* Sound bank
+ *
+ * One-shot effects are decoded completely when they're loaded, into a single
+ * block of float PCM carved out of an arena up front. Each sound is a
+ * MixerSample pointing into that block, and its id is just its index, so
+ * playing one is a command push: no decoding, allocation or lookup.
+ *
+ * Loading happens on the game thread before anything plays; the bank isn't
+ * touched again except for the audio thread reading samples.
+ */
+#define SoundBankMaxSounds 256
+#define SoundBankBytes Megabytes(32)
+
+typedef struct SoundBank_
+{
+	MixerSample sounds[SoundBankMaxSounds];
+	u64 hashes[SoundBankMaxSounds];
+	i32 count;
+
+	f32* pcm;
+	isize used;
+	isize capacity;
+} SoundBank;
+
+SoundBank sound_bank;
+
+void sound_bank_init(SoundBank* bank, MemoryArena* arena, isize bytes)
+{
+	memset(bank, 0, sizeof(SoundBank));
+	bank->pcm = arena_push(arena, bytes);
+	if(bank->pcm == NULL) return;
+	bank->capacity = bytes / sizeof(f32);
+}
+
+//Returns space for frames * channels floats at the end of the block, or NULL
+static
+f32* sound_bank_reserve(SoundBank* bank, u64 frames, i32 channels, string name)
+{
+	u64 count = frames * channels;
+	if(frames == 0 || count > (u64)(bank->capacity - bank->used)) {
+		log_error("Error: no room in the sound bank for %s", name);
+		return NULL;
+	}
+	return bank->pcm + bank->used;
+}
+
+//Decodes a wav, flac or ogg vorbis file; returns the new sound's id, or -1.
+//A sound that fails still takes up its slot (as silence) so later ids don't shift.
+i32 sound_bank_load(SoundBank* bank, string name, void* data, isize size)
+{
+	if(bank->count >= SoundBankMaxSounds) {
+		log_error("Error: sound bank is full, can't load %s", name);
+		return -1;
+	}
+
+	MixerSample* sound = bank->sounds + bank->count;
+	f32* pcm = NULL;
+	u64 frames = 0;
+	i32 channels = 0;
+	u32 sample_rate = 0;
+	u8* magic = data;
+	memset(sound, 0, sizeof(MixerSample));
+	bank->hashes[bank->count] = hash_string(name);
+
+	if(size > 4 && memcmp(magic, "RIFF", 4) == 0) {
+		drwav* wav = drwav_open_memory(data, size);
+		if(wav != NULL) {
+			channels = wav->channels;
+			sample_rate = wav->sampleRate;
+			frames = wav->totalSampleCount / channels;
+			pcm = sound_bank_reserve(bank, frames, channels, name);
+			if(pcm != NULL) {
+				frames = drwav_read_f32(wav, frames * channels, pcm) / channels;
+			}
+			drwav_close(wav);
+		}
+	} else if(size > 4 && memcmp(magic, "fLaC", 4) == 0) {
+		drflac* flac = drflac_open_memory(data, size);
+		if(flac != NULL) {
+			channels = flac->channels;
+			sample_rate = flac->sampleRate;
+			frames = flac->totalSampleCount / channels;
+			pcm = sound_bank_reserve(bank, frames, channels, name);
+			if(pcm != NULL) {
+				//i32 and f32 are the same size, so convert in place
+				i32* samples = (i32*)pcm;
+				u64 count = drflac_read_s32(flac, frames * channels, samples);
+				for(u64 i = 0; i < count; ++i) {
+					pcm[i] = samples[i] / 2147483648.0f;
+				}
+				frames = count / channels;
+			}
+			drflac_close(flac);
+		}
+	} else if(size > 4 && memcmp(magic, "OggS", 4) == 0) {
+		i32 error = 0;
+		stb_vorbis* vorbis = stb_vorbis_open_memory(data, size, &error, NULL);
+		if(vorbis != NULL) {
+			stb_vorbis_info info = stb_vorbis_get_info(vorbis);
+			//The mixer only reads the first two channels anyway
+			channels = info.channels > 2 ? 2 : info.channels;
+			sample_rate = info.sample_rate;
+			frames = stb_vorbis_stream_length_in_samples(vorbis);
+			pcm = sound_bank_reserve(bank, frames, channels, name);
+			if(pcm != NULL) {
+				frames = stb_vorbis_get_samples_float_interleaved(vorbis, channels, pcm, (i32)(frames * channels));
+			}
+			stb_vorbis_close(vorbis);
+		}
+	}
+
+	if(pcm == NULL || frames == 0) {
+		log_error("Error: could not decode sound %s", name);
+		bank->count++;
+		return -1;
+	}
+
+	bank->used += frames * channels;
+	sound->data = pcm;
+	sound->frames = frames;
+	sound->channels = channels;
+	sound->sample_rate = sample_rate;
+	sound->format = SampleFormat_F32;
+	return bank->count++;
+}
+
+//Slow, for startup; keep the id around instead of looking it up per play
+i32 sound_bank_find(SoundBank* bank, string name)
+{
+	u64 hash = hash_string(name);
+	for(i32 i = 0; i < bank->count; ++i) {
+		if(bank->hashes[i] == hash) return i;
+	}
+	return -1;
+}
+
+//Audio thread
+static
+i32 audio_find_voice(AudioCommandQueue* queue, SoundHandle handle)
+{
+	//voice_handles is by voice, so it isn't sorted by handle: voices go to
+	//whichever slot is free. That's why this is the unsorted search, which
+	//checks every slot a few at a time rather than walking mixer.active
+	//through an index. Handles are never reused, so a stopped voice's old
+	//one can't match a live sound's.
+	isize index = search_find_u32(handle, queue->voice_handles, MixerMaxVoices);
+	if(index == -1 || mixer.voices[index].state == Voice_Stopped) return -1;
+	return (i32)index;
+}
+
+//Audio thread
+static
+void audio_commands_execute(AudioCommandQueue* queue)
+{
+	u32 read = SDL_AtomicGet(&queue->read);
+	u32 write = SDL_AtomicGet(&queue->write);
+	for(; read != write; ++read) {
+		AudioCommand* command = queue->commands + (read & (AudioCommandCapacity - 1));
+		i32 voice = -1;
+		if(command->kind >= AudioCommand_Stop && command->kind <= AudioCommand_Fade) {
+			voice = audio_find_voice(queue, command->handle);
+			if(voice == -1) continue;
+		}
+
+		switch(command->kind) {
+			case AudioCommand_Play:
+				voice = mixer_play_sample(&mixer, sound_bank.sounds + command->sound, 
+						command->gain, command->pitch, command->pan);
+				if(voice != -1) {
+					queue->voice_handles[voice] = command->handle;
+				}
+				break;
+			case AudioCommand_Stop:
+				mixer_stop_voice(&mixer, voice);
+				break;
+			case AudioCommand_SetGain:
+				mixer.voices[voice].gain = command->gain;
+				mixer.voices[voice].fade_frames = 0;
+				break;
+			case AudioCommand_SetPan:
+				mixer.voices[voice].pan = command->pan;
+				break;
+			case AudioCommand_Fade:
+				mixer_fade_voice(&mixer, voice, command->gain, command->frames, command->gain <= 0);
+				break;
+			case AudioCommand_MasterGain:
+				mixer.gain = command->gain;
+				break;
+			case AudioCommand_MusicStart:
+				music.playing = true;
+				music.filling = true;
+				music.gain = command->gain;
+				break;
+			case AudioCommand_MusicStop:
+				music.playing = false;
+				SDL_AtomicSet(&music.ring.read, command->frames);
+				break;
+			case AudioCommand_MusicGain:
+				music.gain = command->gain;
+				break;
+		}
+	}
+	SDL_AtomicSet(&queue->read, read);
+}
+
+//Everything below is for the game thread.
+
+//pan is -1 (left) to 1 (right), pitch 1 is unchanged. Returns 0 if the sound
+//isn't loaded; the sound can still fail to start if every voice is busy.
+SoundHandle play_sound(i32 id, f32 gain, f32 pan, f32 pitch)
+{
+	if(id < 0 || id >= sound_bank.count || sound_bank.sounds[id].frames == 0) return 0;
+	AudioCommand command;
+	memset(&command, 0, sizeof(AudioCommand));
+	command.kind = AudioCommand_Play;
+	//0 is never handed out
+	if(++audio_commands.next_handle == 0) audio_commands.next_handle++;
+	command.handle = audio_commands.next_handle;
+	command.sound = id;
+	command.gain = gain;
+	command.pan = pan;
+	command.pitch = pitch;
+	if(!audio_command_push(&audio_commands, &command)) return 0;
+	return command.handle;
+}
+
+void sound_stop(SoundHandle handle)
+{
+	audio_command_send(AudioCommand_Stop, handle, 0, 0);
+}
+
+void sound_set_gain(SoundHandle handle, f32 gain)
+{
+	audio_command_send(AudioCommand_SetGain, handle, gain, 0);
+}
 
+void sound_set_pan(SoundHandle handle, f32 pan)
+{
+	AudioCommand command;
+	memset(&command, 0, sizeof(AudioCommand));
+	command.kind = AudioCommand_SetPan;
+	command.handle = handle;
+	command.pan = pan;
+	audio_command_push(&audio_commands, &command);
+}
+
+//Fading to 0 stops the sound at the end
+void sound_fade(SoundHandle handle, f32 gain, f32 seconds)
+{
+	audio_command_send(AudioCommand_Fade, handle, gain, (u32)(seconds * mixer.sample_rate));
+}
+
+void audio_set_master_gain(f32 gain)
+{
+	audio_command_send(AudioCommand_MasterGain, 0, gain, 0);
+}
+
+void music_set_gain(f32 gain)
+{
+	audio_command_send(AudioCommand_MusicGain, 0, gain, 0);
+}
+
+static void audio_callback(void* user, u8* stream, i32 len)
+{
+	u32 frames = len / (sizeof(AudioType) * AudioChannels);
+	f32* out = (f32*)stream;
+	memset(out, 0, len);
+	audio_commands_execute(&audio_commands);
+	mixer_mix_voices(&mixer, out, frames);
+
+	if(music.playing) {
+		u32 mixed = audio_ring_mix(&music.ring, out, frames, music.gain);
+		if(mixed == frames) {
+			music.filling = false;
+		} else if(!music.filling && !SDL_AtomicGet(&music.finished)) {
+			audio_underruns++;
+		}
+	}
+
+	mixer_clamp(out, frames, mixer.gain);
+}
 
+//Everything but the device; the offline renderer calls this directly and
+//runs audio_callback itself
+void audio_init_state(MemoryArena* arena, u32 sample_rate)
+{
+	mixer_init(&mixer, sample_rate, arena);
+
+	//Sized for up to 8 channel sources: s32 flac samples, and a float
+	//staging area for mono/multichannel wav ahead of the stereo output
+	music.ring.data = malloc(sizeof(f32) * AudioChannels * MusicRingFrames);
+	music.decode_buffer = malloc(sizeof(f32) * MusicDecodeFrames * (8 + AudioChannels));
+	music.decode_buffer_s32 = malloc(sizeof(i32) * MusicDecodeFrames * 8);
+	music.resample_window = malloc(sizeof(f32) * MusicResampleWindow * 2);
+	music.resample_buffer = malloc(sizeof(f32) * AudioChannels * MusicDecodeFrames * MusicMaxUpsample);
+	music.kind = MusicSource_None;
+	audio_ring_init(&music.ring, music.ring.data, MusicRingFrames);
+	audio_commands.open = true;
+}
+
+void init_audio(MemoryArena* arena)
+{
+	SDL_AudioSpec want, have;
+	SDL_zero(want);
+	want.format = AudioForSDL;
+	want.freq = AudioSampleRate;
+	want.channels = AudioChannels;
+	want.userdata = NULL;
+	want.samples = AudioCallbackFrames;
+	want.callback = audio_callback;
+	audio_device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+	if(audio_device == 0) {
+		//Carry on silently; sounds and music are dropped before they're queued
+		log_error("Error: could not open audio device: %s", SDL_GetError());
+		audio_init_state(arena, AudioSampleRate);
+		audio_commands.open = false;
+		return;
+	}
+
+	audio_init_state(arena, have.freq);
+	SDL_PauseAudioDevice(audio_device, 0);
 }
+
+//Joins the decoder before closing the device, which waits out the callback
+void audio_shutdown()
+{
+	music_stop();
+	audio_commands.open = false;
+	if(audio_device != 0) {
+		SDL_CloseAudioDevice(audio_device);
+		audio_device = 0;
+	}
+}
+
@@ -0,0 +1,365 @@
+
+/* Offline audio
+ *
+ * For machines without a sound device (the build machines). Both modes run
+ * before the window or GL exist and return an exit code for main.
+ *
+ * audio_render_offline drives audio_callback from a fake clock, following a
+ * cue file, and writes what comes out to a float WAV so mixes can be diffed
+ * against reference renders. Cue files are one command per line, times in
+ * seconds, in order; # starts a comment. Sounds and music are looked up in the
+ * asset pack if there is one, otherwise read from disk.
+ *
+ *	0.0   music assets/song.ogg 0.8 1     -- file, gain, loop
+ *	0.5   play assets/hit.wav 1 -0.5 1.2  -- file, gain, pan, pitch
+ *	1.0   fade 0 0 0.25                   -- nth play (from 0), gain, seconds
+ *	1.0   gain 1 0.5
+ *	1.0   pan 1 0.5
+ *	1.5   stop 1
+ *	2.0   music_gain 0.5
+ *	2.5   music_stop
+ *	3.0   end
+ *
+ * Music is decoded on its usual thread, so each block waits for the ring to
+ * have enough in it first; output doesn't depend on how fast the machine is.
+ *
+ * audio_bench_mixer times mixer_mix_voices on made up samples.
+ */
+
+#define AudioCueMax 1024
+#define AudioCueMaxPlays 256
+
+typedef enum AudioCueKind_
+{
+	AudioCue_Play,
+	AudioCue_Stop,
+	AudioCue_Fade,
+	AudioCue_Gain,
+	AudioCue_Pan,
+	AudioCue_Music,
+	AudioCue_MusicGain,
+	AudioCue_MusicStop,
+	AudioCue_End
+} AudioCueKind;
+
+typedef struct AudioCue_
+{
+	AudioCueKind kind;
+	u64 frame;
+	i32 sound;
+	i32 play;
+	f32 gain;
+	f32 pan;
+	f32 pitch;
+	f32 seconds;
+	i32 loop;
+	void* music_data;
+	isize music_size;
+} AudioCue;
+
+typedef struct AudioCueList_
+{
+	AudioCue cues[AudioCueMax];
+	i32 count;
+	i32 play_count;
+	AssetPack* pack;
+} AudioCueList;
+
+//Pack first, then disk; disk reads are never freed, this runs once
+static
+void* audio_cue_load_file(AudioCueList* list, string name, isize* size_out)
+{
+	void* data = NULL;
+	if(list->pack != NULL) {
+		data = asset_pack_get(list->pack, name, size_out);
+	}
+	if(data == NULL) {
+		data = platform_read_file(name, size_out,
+				allocator_create(platform_malloc_wrapper, platform_free_wrapper, NULL, NULL));
+	}
+	return data;
+}
+
+static
+i32 audio_cue_parse(AudioCueList* list, string filename, u32 sample_rate)
+{
+	FILE* fp = fopen(filename, "r");
+	if(fp == NULL) {
+		log_error("Error: could not open cue file %s", filename);
+		return false;
+	}
+
+	char line[1024];
+	i32 line_number = 0;
+	u64 last_frame = 0;
+	while(fgets(line, sizeof(line), fp)) {
+		line_number++;
+		char* comment = strchr(line, '#');
+		if(comment != NULL) *comment = '\0';
+
+		f64 seconds;
+		char command[64];
+		i32 offset = 0;
+		if(sscanf(line, " %lf %63s %n", &seconds, command, &offset) < 2) continue;
+		char* args = line + offset;
+
+		if(list->count >= AudioCueMax) {
+			log_error("Error: %s has more than %d cues", filename, AudioCueMax);
+			break;
+		}
+		AudioCue* cue = list->cues + list->count;
+		memset(cue, 0, sizeof(AudioCue));
+		cue->frame = (u64)(seconds * sample_rate + 0.5);
+		cue->gain = 1.0f;
+		cue->pitch = 1.0f;
+		if(cue->frame < last_frame) {
+			log_error("Error: %s:%d is earlier than the cue before it", filename, line_number);
+			fclose(fp);
+			return false;
+		}
+		last_frame = cue->frame;
+
+		char name[512];
+		i32 ok = true;
+		if(strcmp(command, "play") == 0) {
+			ok = sscanf(args, "%511s %f %f %f", name, &cue->gain, &cue->pan, &cue->pitch) >= 1;
+			if(ok) {
+				cue->kind = AudioCue_Play;
+				cue->play = list->play_count++;
+				cue->sound = sound_bank_find(&sound_bank, name);
+				if(cue->sound == -1) {
+					isize size = 0;
+					void* data = audio_cue_load_file(list, name, &size);
+					cue->sound = sound_bank_load(&sound_bank, name, data, size);
+				}
+				ok = list->play_count <= AudioCueMaxPlays;
+			}
+		} else if(strcmp(command, "stop") == 0) {
+			cue->kind = AudioCue_Stop;
+			ok = sscanf(args, "%d", &cue->play) == 1;
+		} else if(strcmp(command, "fade") == 0) {
+			cue->kind = AudioCue_Fade;
+			ok = sscanf(args, "%d %f %f", &cue->play, &cue->gain, &cue->seconds) == 3;
+		} else if(strcmp(command, "gain") == 0) {
+			cue->kind = AudioCue_Gain;
+			ok = sscanf(args, "%d %f", &cue->play, &cue->gain) == 2;
+		} else if(strcmp(command, "pan") == 0) {
+			cue->kind = AudioCue_Pan;
+			ok = sscanf(args, "%d %f", &cue->play, &cue->pan) == 2;
+		} else if(strcmp(command, "music") == 0) {
+			cue->kind = AudioCue_Music;
+			ok = sscanf(args, "%511s %f %d", name, &cue->gain, &cue->loop) >= 1;
+			if(ok) {
+				cue->music_data = audio_cue_load_file(list, name, &cue->music_size);
+				ok = cue->music_data != NULL;
+			}
+		} else if(strcmp(command, "music_gain") == 0) {
+			cue->kind = AudioCue_MusicGain;
+			ok = sscanf(args, "%f", &cue->gain) == 1;
+		} else if(strcmp(command, "music_stop") == 0) {
+			cue->kind = AudioCue_MusicStop;
+		} else if(strcmp(command, "end") == 0) {
+			cue->kind = AudioCue_End;
+		} else {
+			ok = false;
+		}
+
+		if(!ok) {
+			log_error("Error: %s:%d: bad cue \"%s\"", filename, line_number, command);
+			fclose(fp);
+			return false;
+		}
+		if(cue->play < 0 || cue->play >= AudioCueMaxPlays) cue->play = 0;
+		list->count++;
+	}
+	fclose(fp);
+	return true;
+}
+
+static
+void audio_cue_dispatch(AudioCue* cue, SoundHandle* handles)
+{
+	switch(cue->kind) {
+		case AudioCue_Play:
+			handles[cue->play] = play_sound(cue->sound, cue->gain, cue->pan, cue->pitch);
+			break;
+		case AudioCue_Stop: sound_stop(handles[cue->play]); break;
+		case AudioCue_Fade: sound_fade(handles[cue->play], cue->gain, cue->seconds); break;
+		case AudioCue_Gain: sound_set_gain(handles[cue->play], cue->gain); break;
+		case AudioCue_Pan: sound_set_pan(handles[cue->play], cue->pan); break;
+		case AudioCue_Music: music_play(cue->music_data, cue->music_size, cue->gain, cue->loop); break;
+		case AudioCue_MusicGain: music_set_gain(cue->gain); break;
+		case AudioCue_MusicStop: music_stop(); break;
+		case AudioCue_End: break;
+	}
+}
+
+//dr_wav can only read, so this writes the header itself. Sizes are patched
+//in by audio_wav_finish once the frame count is known.
+static
+void audio_wav_write_header(FILE* fp, u32 sample_rate, u32 frames)
+{
+	u32 data_size = frames * AudioChannels * sizeof(f32);
+	u32 riff_size = 36 + data_size;
+	u16 format = 3; //WAVE_FORMAT_IEEE_FLOAT
+	u16 channels = AudioChannels;
+	u32 byte_rate = sample_rate * AudioChannels * sizeof(f32);
+	u16 block_align = AudioChannels * sizeof(f32);
+	u16 bits = 32;
+	u32 fmt_size = 16;
+
+	fwrite("RIFF", 1, 4, fp);
+	fwrite(&riff_size, 4, 1, fp);
+	fwrite("WAVEfmt ", 1, 8, fp);
+	fwrite(&fmt_size, 4, 1, fp);
+	fwrite(&format, 2, 1, fp);
+	fwrite(&channels, 2, 1, fp);
+	fwrite(&sample_rate, 4, 1, fp);
+	fwrite(&byte_rate, 4, 1, fp);
+	fwrite(&block_align, 2, 1, fp);
+	fwrite(&bits, 2, 1, fp);
+	fwrite("data", 1, 4, fp);
+	fwrite(&data_size, 4, 1, fp);
+}
+
+static
+void audio_wav_finish(FILE* fp, u32 sample_rate, u32 frames)
+{
+	fseek(fp, 0, SEEK_SET);
+	audio_wav_write_header(fp, sample_rate, frames);
+	fclose(fp);
+}
+
+i32 audio_render_offline(GameSettings* settings, string cue_file, string out_file)
+{
+	MemoryArena* arena = arena_bootstrap("OfflineAudioArena", Megabytes(1));
+	AudioCueList* list = calloc(1, sizeof(AudioCueList));
+	SoundHandle* handles = calloc(AudioCueMaxPlays, sizeof(SoundHandle));
+
+	AssetPack pack;
+	{
+		char* base_path = SDL_GetBasePath();
+		char fn_buf[4096];
+		snprintf(fn_buf, 4096, "%s%s", base_path != NULL ? base_path : "", settings->archive_name);
+		if(asset_pack_open(&pack, fn_buf)) {
+			list->pack = &pack;
+		}
+	}
+
+	audio_init_state(arena, AudioSampleRate);
+	sound_bank_init(&sound_bank, arena_bootstrap("SoundArena", SoundBankBytes), SoundBankBytes);
+	if(!audio_cue_parse(list, cue_file, mixer.sample_rate)) {
+		return 1;
+	}
+
+	FILE* fp = fopen(out_file, "wb");
+	if(fp == NULL) {
+		log_error("Error: could not write %s", out_file);
+		return 1;
+	}
+	audio_wav_write_header(fp, mixer.sample_rate, 0);
+
+	//Without an end cue, stop a second after the last one
+	u64 end = list->count > 0 ? list->cues[list->count - 1].frame : 0;
+	if(list->count == 0 || list->cues[list->count - 1].kind != AudioCue_End) {
+		end += mixer.sample_rate;
+	}
+
+	f32* buffer = malloc(sizeof(f32) * AudioChannels * AudioCallbackFrames);
+	u64 frame = 0;
+	i32 next = 0;
+	while(frame < end) {
+		while(next < list->count && list->cues[next].frame <= frame) {
+			audio_cue_dispatch(list->cues + next, handles);
+			next++;
+		}
+
+		//Blocks stop at the next cue, so every cue lands on its exact frame
+		u64 block = AudioCallbackFrames;
+		if(next < list->count && list->cues[next].frame - frame < block) {
+			block = list->cues[next].frame - frame;
+		}
+		if(end - frame < block) block = end - frame;
+
+		//Run the commands now rather than in the callback, so a music switch
+		//has happened before waiting on the new stream
+		audio_commands_execute(&audio_commands);
+		if(music.playing) {
+			while(audio_ring_available(&music.ring) < block && !SDL_AtomicGet(&music.finished)) {
+				SDL_Delay(1);
+			}
+		}
+
+		audio_callback(NULL, (u8*)buffer, (i32)(block * AudioChannels * sizeof(f32)));
+		fwrite(buffer, sizeof(f32) * AudioChannels, block, fp);
+		frame += block;
+	}
+
+	music_stop();
+	audio_wav_finish(fp, mixer.sample_rate, (u32)frame);
+	printf("Rendered %.2fs of audio to %s\n", (f64)frame / mixer.sample_rate, out_file);
+	return 0;
+}
+
+//10ms at 44.1kHz
+#define AudioBenchBlockFrames 441
+#define AudioBenchBlocks 1000
+
+i32 audio_bench_mixer()
+{
+	MemoryArena* arena = arena_bootstrap("MixerBenchArena", Megabytes(8));
+	RandomState random;
+	randomstate_init(&random, 1);
+
+	//One of each format, at rates that don't match the mixer's
+	u32 frames = AudioSampleRate * 2;
+	i16* mono = arena_push(arena, sizeof(i16) * frames);
+	f32* stereo = arena_push(arena, sizeof(f32) * frames * 2);
+	for(u32 i = 0; i < frames; ++i) {
+		mono[i] = (i16)rand_range_int(&random, -16000, 16000);
+		stereo[i * 2] = rand_range(&random, -0.5f, 0.5f);
+		stereo[i * 2 + 1] = rand_range(&random, -0.5f, 0.5f);
+	}
+	MixerSample samples[2] = {
+		{mono, frames, 1, 22050, SampleFormat_S16},
+		{stereo, frames, 2, 48000, SampleFormat_F32}
+	};
+
+	f32* out = arena_push(arena, sizeof(f32) * AudioChannels * AudioBenchBlockFrames);
+	string kernel_names[ResampleKernel_Count] = {"linear", "cubic", "sinc"};
+	i32 voice_counts[] = {8, 32, 128};
+	f64 ticks_to_us = 1000000.0 / SDL_GetPerformanceFrequency();
+
+	printf("Mixer: microseconds per %d frame block (10ms at %dHz), %d blocks\n",
+			AudioBenchBlockFrames, AudioSampleRate, AudioBenchBlocks);
+	printf("%-8s %8s %10s %10s\n", "kernel", "voices", "mean", "best");
+	for(i32 k = 0; k < ResampleKernel_Count; ++k) {
+		for(i32 v = 0; v < 3; ++v) {
+			Mixer* bench = arena_push(arena, sizeof(Mixer));
+			mixer_init(bench, AudioSampleRate, arena);
+			bench->kernel = k;
+
+			u64 total = 0, best = UINT64_MAX;
+			for(i32 b = 0; b < AudioBenchBlocks; ++b) {
+				//Keep every voice busy; restarts aren't timed
+				while(bench->active_count < voice_counts[v]) {
+					MixerSample* sample = samples + (bench->active_count & 1);
+					mixer_play_sample(bench, sample, 0.1f,
+							rand_range(&random, 0.5f, 2.0f), rand_range(&random, -1.0f, 1.0f));
+				}
+
+				memset(out, 0, sizeof(f32) * AudioChannels * AudioBenchBlockFrames);
+				u64 start = SDL_GetPerformanceCounter();
+				mixer_mix_voices(bench, out, AudioBenchBlockFrames);
+				mixer_clamp(out, AudioBenchBlockFrames, 1.0f);
+				u64 elapsed = SDL_GetPerformanceCounter() - start;
+				total += elapsed;
+				if(elapsed < best) best = elapsed;
+			}
+			printf("%-8s %8d %10.2f %10.2f\n", kernel_names[k], voice_counts[v],
+					total * ticks_to_us / AudioBenchBlocks, best * ticks_to_us);
+		}
+	}
+	return 0;
+}
+
@@ -0,0 +1,568 @@
+
+/* Batch math
+ *
+ * Structure-of-arrays versions of the Vec2 and AABB routines in ld_math.c,
+ * for passes over a lot of things at once. Vectors are a pair of x[] and y[]
+ * streams, AABBs four streams of center and half extents (the same meaning
+ * aabb_ gives a Rect2). Output streams can be the same as input ones.
+ *
+ * Each routine has a scalar, SSE2 and AVX2 version. The SSE2 ones are the
+ * default wherever the compiler has SSE (always, on x64); batch_init checks
+ * the CPU and switches to AVX2 if it's there. Streams don't need to be
+ * aligned; leftovers past the last full vector go through the scalar code.
+ */
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BATCH_SSE2
+#include <emmintrin.h>
+#endif
+
+//MSVC lets any function use AVX intrinsics; gcc and clang need telling per function
+#if defined(BATCH_SSE2) && defined(_MSC_VER)
+#define BATCH_AVX2
+#define BatchAvx2Target
+#elif defined(BATCH_SSE2) && defined(__GNUC__)
+#define BATCH_AVX2
+#define BatchAvx2Target __attribute__((target("avx2")))
+#endif
+
+#ifdef BATCH_AVX2
+#include <immintrin.h>
+#endif
+
+typedef struct Vec2Stream_
+{
+	f32* x;
+	f32* y;
+} Vec2Stream;
+
+//Centers and half extents
+typedef struct AabbStream_
+{
+	f32* x;
+	f32* y;
+	f32* hw;
+	f32* hh;
+} AabbStream;
+
+typedef enum BatchLevel_
+{
+	Batch_Scalar,
+	Batch_SSE2,
+	Batch_AVX2,
+	BatchLevel_Count
+} BatchLevel;
+
+const string BatchLevelNames[BatchLevel_Count] = {
+	"scalar",
+	"sse2",
+	"avx2"
+};
+
+typedef struct BatchProcs_
+{
+	void (*add)(Vec2Stream* out, const Vec2Stream* a, const Vec2Stream* b, isize count);
+	void (*scale)(Vec2Stream* out, const Vec2Stream* a, f32 f, isize count);
+	void (*normalize)(Vec2Stream* out, const Vec2Stream* a, isize count);
+	void (*rotate)(Vec2Stream* out, const Vec2Stream* a, f32 c, f32 s, isize count);
+	isize (*intersect)(const Rect2* a, const AabbStream* b, isize count, i32* hits);
+	void (*overlap)(Vec2Stream* out, const Rect2* a, const AabbStream* b, isize count);
+} BatchProcs;
+
+/* Scalar
+ *
+ * Each takes a start index so the vector versions can hand it their tails.
+ */
+
+static
+void batch_add_scalar_from(Vec2Stream* out, const Vec2Stream* a, const Vec2Stream* b, isize i, isize count)
+{
+	for(; i < count; ++i) {
+		out->x[i] = a->x[i] + b->x[i];
+		out->y[i] = a->y[i] + b->y[i];
+	}
+}
+
+static
+void batch_scale_scalar_from(Vec2Stream* out, const Vec2Stream* a, f32 f, isize i, isize count)
+{
+	for(; i < count; ++i) {
+		out->x[i] = a->x[i] * f;
+		out->y[i] = a->y[i] * f;
+	}
+}
+
+//Unlike v2_normalize, zero length vectors stay zero rather than going NaN
+static
+void batch_normalize_scalar_from(Vec2Stream* out, const Vec2Stream* a, isize i, isize count)
+{
+	for(; i < count; ++i) {
+		f32 x = a->x[i], y = a->y[i];
+		f32 mag = sqrtf(x * x + y * y);
+		if(mag > 0) {
+			out->x[i] = x / mag;
+			out->y[i] = y / mag;
+		} else {
+			out->x[i] = 0;
+			out->y[i] = 0;
+		}
+	}
+}
+
+static
+void batch_rotate_scalar_from(Vec2Stream* out, const Vec2Stream* a, f32 c, f32 s, isize i, isize count)
+{
+	for(; i < count; ++i) {
+		f32 x = a->x[i], y = a->y[i];
+		out->x[i] = x * c - y * s;
+		out->y[i] = x * s + y * c;
+	}
+}
+
+static
+isize batch_intersect_scalar_from(const Rect2* a, const AabbStream* b, isize i, isize count, i32* hits, isize hit_count)
+{
+	for(; i < count; ++i) {
+		hits[hit_count] = (i32)i;
+		hit_count += !(fabsf(b->x[i] - a->pos.x) > (b->hw[i] + a->size.x)) &&
+			!(fabsf(b->y[i] - a->pos.y) > (b->hh[i] + a->size.y));
+	}
+	return hit_count;
+}
+
+static
+void batch_overlap_scalar_from(Vec2Stream* out, const Rect2* a, const AabbStream* b, isize i, isize count)
+{
+	for(; i < count; ++i) {
+		Rect2 r = rect2(b->x[i], b->y[i], b->hw[i], b->hh[i]);
+		Vec2 v = aabb_overlap(a, &r);
+		out->x[i] = v.x;
+		out->y[i] = v.y;
+	}
+}
+
+static
+void batch_add_scalar(Vec2Stream* out, const Vec2Stream* a, const Vec2Stream* b, isize count)
+{
+	batch_add_scalar_from(out, a, b, 0, count);
+}
+
+static
+void batch_scale_scalar(Vec2Stream* out, const Vec2Stream* a, f32 f, isize count)
+{
+	batch_scale_scalar_from(out, a, f, 0, count);
+}
+
+static
+void batch_normalize_scalar(Vec2Stream* out, const Vec2Stream* a, isize count)
+{
+	batch_normalize_scalar_from(out, a, 0, count);
+}
+
+static
+void batch_rotate_scalar(Vec2Stream* out, const Vec2Stream* a, f32 c, f32 s, isize count)
+{
+	batch_rotate_scalar_from(out, a, c, s, 0, count);
+}
+
+static
+isize batch_intersect_scalar(const Rect2* a, const AabbStream* b, isize count, i32* hits)
+{
+	return batch_intersect_scalar_from(a, b, 0, count, hits, 0);
+}
+
+static
+void batch_overlap_scalar(Vec2Stream* out, const Rect2* a, const AabbStream* b, isize count)
+{
+	batch_overlap_scalar_from(out, a, b, 0, count);
+}
+
+#ifdef BATCH_SSE2
+
+static
+void batch_add_sse2(Vec2Stream* out, const Vec2Stream* a, const Vec2Stream* b, isize count)
+{
+	isize i = 0;
+	for(; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(out->x + i, _mm_add_ps(_mm_loadu_ps(a->x + i), _mm_loadu_ps(b->x + i)));
+		_mm_storeu_ps(out->y + i, _mm_add_ps(_mm_loadu_ps(a->y + i), _mm_loadu_ps(b->y + i)));
+	}
+	batch_add_scalar_from(out, a, b, i, count);
+}
+
+static
+void batch_scale_sse2(Vec2Stream* out, const Vec2Stream* a, f32 f, isize count)
+{
+	__m128 vf = _mm_set1_ps(f);
+	isize i = 0;
+	for(; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(out->x + i, _mm_mul_ps(_mm_loadu_ps(a->x + i), vf));
+		_mm_storeu_ps(out->y + i, _mm_mul_ps(_mm_loadu_ps(a->y + i), vf));
+	}
+	batch_scale_scalar_from(out, a, f, i, count);
+}
+
+//A real sqrt and divide rather than rsqrt, so it matches the scalar version
+static
+void batch_normalize_sse2(Vec2Stream* out, const Vec2Stream* a, isize count)
+{
+	__m128 zero = _mm_setzero_ps();
+	isize i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m128 x = _mm_loadu_ps(a->x + i);
+		__m128 y = _mm_loadu_ps(a->y + i);
+		__m128 mag = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)));
+		__m128 nonzero = _mm_cmpgt_ps(mag, zero);
+		_mm_storeu_ps(out->x + i, _mm_and_ps(nonzero, _mm_div_ps(x, mag)));
+		_mm_storeu_ps(out->y + i, _mm_and_ps(nonzero, _mm_div_ps(y, mag)));
+	}
+	batch_normalize_scalar_from(out, a, i, count);
+}
+
+static
+void batch_rotate_sse2(Vec2Stream* out, const Vec2Stream* a, f32 c, f32 s, isize count)
+{
+	__m128 vc = _mm_set1_ps(c);
+	__m128 vs = _mm_set1_ps(s);
+	isize i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m128 x = _mm_loadu_ps(a->x + i);
+		__m128 y = _mm_loadu_ps(a->y + i);
+		_mm_storeu_ps(out->x + i, _mm_sub_ps(_mm_mul_ps(x, vc), _mm_mul_ps(y, vs)));
+		_mm_storeu_ps(out->y + i, _mm_add_ps(_mm_mul_ps(x, vs), _mm_mul_ps(y, vc)));
+	}
+	batch_rotate_scalar_from(out, a, c, s, i, count);
+}
+
+//hits gets written past the last hit (never past count), so each lane can
+//be stored without a branch and only counted if it hit
+static
+isize batch_intersect_sse2(const Rect2* a, const AabbStream* b, isize count, i32* hits)
+{
+	__m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	__m128 ax = _mm_set1_ps(a->pos.x), ay = _mm_set1_ps(a->pos.y);
+	__m128 aw = _mm_set1_ps(a->size.x), ah = _mm_set1_ps(a->size.y);
+	isize hit_count = 0;
+	isize i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m128 dx = _mm_and_ps(abs_mask, _mm_sub_ps(_mm_loadu_ps(b->x + i), ax));
+		__m128 dy = _mm_and_ps(abs_mask, _mm_sub_ps(_mm_loadu_ps(b->y + i), ay));
+		__m128 inside = _mm_and_ps(
+				_mm_cmpngt_ps(dx, _mm_add_ps(_mm_loadu_ps(b->hw + i), aw)),
+				_mm_cmpngt_ps(dy, _mm_add_ps(_mm_loadu_ps(b->hh + i), ah)));
+		i32 mask = _mm_movemask_ps(inside);
+		for(i32 j = 0; j < 4; ++j) {
+			hits[hit_count] = (i32)(i + j);
+			hit_count += (mask >> j) & 1;
+		}
+	}
+	return batch_intersect_scalar_from(a, b, i, count, hits, hit_count);
+}
+
+//Same as aabb_overlap, with the branches turned into selects: push out
+//along whichever axis overlaps less, away from b
+static
+void batch_overlap_sse2(Vec2Stream* out, const Rect2* a, const AabbStream* b, isize count)
+{
+	__m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+	__m128 ax = _mm_set1_ps(a->pos.x), ay = _mm_set1_ps(a->pos.y);
+	__m128 aw = _mm_set1_ps(a->size.x), ah = _mm_set1_ps(a->size.y);
+	isize i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m128 bx = _mm_loadu_ps(b->x + i);
+		__m128 by = _mm_loadu_ps(b->y + i);
+		__m128 sx = _mm_sub_ps(_mm_add_ps(aw, _mm_loadu_ps(b->hw + i)),
+				_mm_andnot_ps(sign_mask, _mm_sub_ps(bx, ax)));
+		__m128 sy = _mm_sub_ps(_mm_add_ps(ah, _mm_loadu_ps(b->hh + i)),
+				_mm_andnot_ps(sign_mask, _mm_sub_ps(by, ay)));
+		__m128 use_y = _mm_cmpgt_ps(sx, sy);
+		sx = _mm_xor_ps(sx, _mm_and_ps(sign_mask, _mm_cmpgt_ps(ax, bx)));
+		sy = _mm_xor_ps(sy, _mm_and_ps(sign_mask, _mm_cmpgt_ps(ay, by)));
+		_mm_storeu_ps(out->x + i, _mm_andnot_ps(use_y, sx));
+		_mm_storeu_ps(out->y + i, _mm_and_ps(use_y, sy));
+	}
+	batch_overlap_scalar_from(out, a, b, i, count);
+}
+
+#endif
+
+#ifdef BATCH_AVX2
+
+static BatchAvx2Target
+void batch_add_avx2(Vec2Stream* out, const Vec2Stream* a, const Vec2Stream* b, isize count)
+{
+	isize i = 0;
+	for(; i + 8 <= count; i += 8) {
+		_mm256_storeu_ps(out->x + i, _mm256_add_ps(_mm256_loadu_ps(a->x + i), _mm256_loadu_ps(b->x + i)));
+		_mm256_storeu_ps(out->y + i, _mm256_add_ps(_mm256_loadu_ps(a->y + i), _mm256_loadu_ps(b->y + i)));
+	}
+	batch_add_scalar_from(out, a, b, i, count);
+}
+
+static BatchAvx2Target
+void batch_scale_avx2(Vec2Stream* out, const Vec2Stream* a, f32 f, isize count)
+{
+	__m256 vf = _mm256_set1_ps(f);
+	isize i = 0;
+	for(; i + 8 <= count; i += 8) {
+		_mm256_storeu_ps(out->x + i, _mm256_mul_ps(_mm256_loadu_ps(a->x + i), vf));
+		_mm256_storeu_ps(out->y + i, _mm256_mul_ps(_mm256_loadu_ps(a->y + i), vf));
+	}
+	batch_scale_scalar_from(out, a, f, i, count);
+}
+
+static BatchAvx2Target
+void batch_normalize_avx2(Vec2Stream* out, const Vec2Stream* a, isize count)
+{
+	__m256 zero = _mm256_setzero_ps();
+	isize i = 0;
+	for(; i + 8 <= count; i += 8) {
+		__m256 x = _mm256_loadu_ps(a->x + i);
+		__m256 y = _mm256_loadu_ps(a->y + i);
+		__m256 mag = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)));
+		__m256 nonzero = _mm256_cmp_ps(mag, zero, _CMP_GT_OQ);
+		_mm256_storeu_ps(out->x + i, _mm256_and_ps(nonzero, _mm256_div_ps(x, mag)));
+		_mm256_storeu_ps(out->y + i, _mm256_and_ps(nonzero, _mm256_div_ps(y, mag)));
+	}
+	batch_normalize_scalar_from(out, a, i, count);
+}
+
+//No FMA here, so the results round the same as the other versions
+static BatchAvx2Target
+void batch_rotate_avx2(Vec2Stream* out, const Vec2Stream* a, f32 c, f32 s, isize count)
+{
+	__m256 vc = _mm256_set1_ps(c);
+	__m256 vs = _mm256_set1_ps(s);
+	isize i = 0;
+	for(; i + 8 <= count; i += 8) {
+		__m256 x = _mm256_loadu_ps(a->x + i);
+		__m256 y = _mm256_loadu_ps(a->y + i);
+		_mm256_storeu_ps(out->x + i, _mm256_sub_ps(_mm256_mul_ps(x, vc), _mm256_mul_ps(y, vs)));
+		_mm256_storeu_ps(out->y + i, _mm256_add_ps(_mm256_mul_ps(x, vs), _mm256_mul_ps(y, vc)));
+	}
+	batch_rotate_scalar_from(out, a, c, s, i, count);
+}
+
+static BatchAvx2Target
+isize batch_intersect_avx2(const Rect2* a, const AabbStream* b, isize count, i32* hits)
+{
+	__m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+	__m256 ax = _mm256_set1_ps(a->pos.x), ay = _mm256_set1_ps(a->pos.y);
+	__m256 aw = _mm256_set1_ps(a->size.x), ah = _mm256_set1_ps(a->size.y);
+	isize hit_count = 0;
+	isize i = 0;
+	for(; i + 8 <= count; i += 8) {
+		__m256 dx = _mm256_and_ps(abs_mask, _mm256_sub_ps(_mm256_loadu_ps(b->x + i), ax));
+		__m256 dy = _mm256_and_ps(abs_mask, _mm256_sub_ps(_mm256_loadu_ps(b->y + i), ay));
+		__m256 inside = _mm256_and_ps(
+				_mm256_cmp_ps(dx, _mm256_add_ps(_mm256_loadu_ps(b->hw + i), aw), _CMP_NGT_UQ),
+				_mm256_cmp_ps(dy, _mm256_add_ps(_mm256_loadu_ps(b->hh + i), ah), _CMP_NGT_UQ));
+		i32 mask = _mm256_movemask_ps(inside);
+		for(i32 j = 0; j < 8; ++j) {
+			hits[hit_count] = (i32)(i + j);
+			hit_count += (mask >> j) & 1;
+		}
+	}
+	return batch_intersect_scalar_from(a, b, i, count, hits, hit_count);
+}
+
+static BatchAvx2Target
+void batch_overlap_avx2(Vec2Stream* out, const Rect2* a, const AabbStream* b, isize count)
+{
+	__m256 sign_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x80000000));
+	__m256 ax = _mm256_set1_ps(a->pos.x), ay = _mm256_set1_ps(a->pos.y);
+	__m256 aw = _mm256_set1_ps(a->size.x), ah = _mm256_set1_ps(a->size.y);
+	isize i = 0;
+	for(; i + 8 <= count; i += 8) {
+		__m256 bx = _mm256_loadu_ps(b->x + i);
+		__m256 by = _mm256_loadu_ps(b->y + i);
+		__m256 sx = _mm256_sub_ps(_mm256_add_ps(aw, _mm256_loadu_ps(b->hw + i)),
+				_mm256_andnot_ps(sign_mask, _mm256_sub_ps(bx, ax)));
+		__m256 sy = _mm256_sub_ps(_mm256_add_ps(ah, _mm256_loadu_ps(b->hh + i)),
+				_mm256_andnot_ps(sign_mask, _mm256_sub_ps(by, ay)));
+		__m256 use_y = _mm256_cmp_ps(sx, sy, _CMP_GT_OQ);
+		sx = _mm256_xor_ps(sx, _mm256_and_ps(sign_mask, _mm256_cmp_ps(ax, bx, _CMP_GT_OQ)));
+		sy = _mm256_xor_ps(sy, _mm256_and_ps(sign_mask, _mm256_cmp_ps(ay, by, _CMP_GT_OQ)));
+		_mm256_storeu_ps(out->x + i, _mm256_andnot_ps(use_y, sx));
+		_mm256_storeu_ps(out->y + i, _mm256_and_ps(use_y, sy));
+	}
+	batch_overlap_scalar_from(out, a, b, i, count);
+}
+
+#endif
+
+BatchProcs BatchProcTable[BatchLevel_Count] = {
+	{
+		batch_add_scalar, batch_scale_scalar, batch_normalize_scalar,
+		batch_rotate_scalar, batch_intersect_scalar, batch_overlap_scalar
+	},
+#ifdef BATCH_SSE2
+	{
+		batch_add_sse2, batch_scale_sse2, batch_normalize_sse2,
+		batch_rotate_sse2, batch_intersect_sse2, batch_overlap_sse2
+	},
+#else
+	{0},
+#endif
+#ifdef BATCH_AVX2
+	{
+		batch_add_avx2, batch_scale_avx2, batch_normalize_avx2,
+		batch_rotate_avx2, batch_intersect_avx2, batch_overlap_avx2
+	}
+#else
+	{0}
+#endif
+};
+
+#ifdef BATCH_SSE2
+BatchLevel batch_level = Batch_SSE2;
+BatchProcs* batch_procs = BatchProcTable + Batch_SSE2;
+#else
+BatchLevel batch_level = Batch_Scalar;
+BatchProcs* batch_procs = BatchProcTable + Batch_Scalar;
+#endif
+
+//Returns false if this build or CPU can't do level
+i32 batch_set_level(BatchLevel level)
+{
+	if(level < 0 || level >= BatchLevel_Count || BatchProcTable[level].add == NULL) return false;
+	if(level == Batch_AVX2 && !SDL_HasAVX2()) return false;
+	batch_level = level;
+	batch_procs = BatchProcTable + level;
+	return true;
+}
+
+#ifdef WB_DEBUG
+/* Self-check
+ *
+ * Debug builds run each level over the same made up vectors and boxes
+ * before picking it, and check it agrees with the scalar code. The values
+ * are quarters, so plenty of boxes just touch, and the count isn't a
+ * multiple of 8, so the scalar tails get run too. Hits have to match
+ * exactly; vectors only to within BatchCheckTolerance of each other, since
+ * /fp:fast lets the compiler rearrange the scalar arithmetic.
+ */
+#define BatchCheckCount 61
+#define BatchCheckTolerance 0.0001f
+
+static
+i32 batch_streams_match(const Vec2Stream* a, const Vec2Stream* b, isize count)
+{
+	for(isize i = 0; i < count; ++i) {
+		//Written so a NaN fails
+		if(!(fabsf(a->x[i] - b->x[i]) <= BatchCheckTolerance) ||
+				!(fabsf(a->y[i] - b->y[i]) <= BatchCheckTolerance)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static
+i32 batch_check_level(BatchLevel level)
+{
+	f32 data[10][BatchCheckCount];
+	u32 seed = 1;
+	for(isize j = 0; j < 6; ++j) {
+		for(isize i = 0; i < BatchCheckCount; ++i) {
+			seed = seed * 1664525 + 1013904223;
+			data[j][i] = ((i32)((seed >> 16) % 64) - 32) * 0.25f;
+		}
+	}
+	Vec2Stream a = {data[0], data[1]};
+	AabbStream boxes = {data[2], data[3], data[4], data[5]};
+	Vec2Stream want = {data[6], data[7]};
+	Vec2Stream got = {data[8], data[9]};
+	for(isize i = 0; i < BatchCheckCount; i += 7) {
+		a.x[i] = a.y[i] = 0;
+	}
+	for(isize i = 0; i < BatchCheckCount; ++i) {
+		boxes.hw[i] = fabsf(boxes.hw[i]);
+		boxes.hh[i] = fabsf(boxes.hh[i]);
+	}
+	Vec2Stream b = {boxes.x, boxes.y};
+	Rect2 r = rect2(0.5f, -0.25f, 3, 2);
+
+	BatchProcs* scalar = BatchProcTable + Batch_Scalar;
+	BatchProcs* procs = BatchProcTable + level;
+	scalar->add(&want, &a, &b, BatchCheckCount);
+	procs->add(&got, &a, &b, BatchCheckCount);
+	if(!batch_streams_match(&want, &got, BatchCheckCount)) return false;
+	scalar->scale(&want, &a, -1.75f, BatchCheckCount);
+	procs->scale(&got, &a, -1.75f, BatchCheckCount);
+	if(!batch_streams_match(&want, &got, BatchCheckCount)) return false;
+	scalar->normalize(&want, &a, BatchCheckCount);
+	procs->normalize(&got, &a, BatchCheckCount);
+	if(!batch_streams_match(&want, &got, BatchCheckCount)) return false;
+	scalar->rotate(&want, &a, cosf(0.3f), sinf(0.3f), BatchCheckCount);
+	procs->rotate(&got, &a, cosf(0.3f), sinf(0.3f), BatchCheckCount);
+	if(!batch_streams_match(&want, &got, BatchCheckCount)) return false;
+	scalar->overlap(&want, &r, &boxes, BatchCheckCount);
+	procs->overlap(&got, &r, &boxes, BatchCheckCount);
+	if(!batch_streams_match(&want, &got, BatchCheckCount)) return false;
+
+	i32 want_hits[BatchCheckCount], got_hits[BatchCheckCount];
+	isize want_count = scalar->intersect(&r, &boxes, BatchCheckCount, want_hits);
+	isize got_count = procs->intersect(&r, &boxes, BatchCheckCount, got_hits);
+	if(want_count != got_count) return false;
+	return memcmp(want_hits, got_hits, sizeof(i32) * want_count) == 0;
+}
+#endif
+
+//Picks the widest level the CPU has (that agrees with the scalar code, in
+//debug builds)
+void batch_init()
+{
+	for(i32 level = BatchLevel_Count - 1; level > Batch_Scalar; --level) {
+		if(!batch_set_level(level)) continue;
+#ifdef WB_DEBUG
+		if(!batch_check_level(level)) {
+			log_error("Error: batch %s doesn't match the scalar code, not using it", BatchLevelNames[level]);
+			continue;
+		}
+#endif
+		return;
+	}
+	batch_set_level(Batch_Scalar);
+}
+
+static inline
+void batch_v2_add(Vec2Stream* out, const Vec2Stream* a, const Vec2Stream* b, isize count)
+{
+	batch_procs->add(out, a, b, count);
+}
+
+static inline
+void batch_v2_scale(Vec2Stream* out, const Vec2Stream* a, f32 f, isize count)
+{
+	batch_procs->scale(out, a, f, count);
+}
+
+static inline
+void batch_v2_normalize(Vec2Stream* out, const Vec2Stream* a, isize count)
+{
+	batch_procs->normalize(out, a, count);
+}
+
+//Counterclockwise by angle radians, the same way v2_from_angle goes
+static inline
+void batch_v2_rotate(Vec2Stream* out, const Vec2Stream* a, f32 angle, isize count)
+{
+	batch_procs->rotate(out, a, cosf(angle), sinf(angle), count);
+}
+
+//Writes the indices of the boxes a touches to hits, which needs room for
+//count of them, and returns how many there were
+static inline
+isize batch_aabb_intersect(const Rect2* a, const AabbStream* b, isize count, i32* hits)
+{
+	return batch_procs->intersect(a, b, count, hits);
+}
+
+//aabb_overlap of a against each box
+static inline
+void batch_aabb_overlap(Vec2Stream* out, const Rect2* a, const AabbStream* b, isize count)
+{
+	batch_procs->overlap(out, a, b, count);
+}
+
@@ -0,0 +1,372 @@
+
+/* Broadphase
+ *
+ * Keeps a set of AABBs (Rect2s as center and half extents, like aabb_) and
+ * answers "what's in this region" and "which pairs overlap" without testing
+ * everything against everything.
+ *
+ * Broadphase is a uniform grid stored as a spatial hash, so the world
+ * doesn't need bounds: a box goes in every cell it covers, and cells hash to
+ * buckets of linked nodes. Items are whatever index the caller uses for
+ * them (below item_capacity). They can be inserted and removed one at a
+ * time, and broadphase_update only touches the buckets when a box changes
+ * cells, so things that mostly sit still are cheap to keep current; or call
+ * broadphase_clear and insert everything again each frame. Cell size wants
+ * to be around the size of a typical box.
+ *
+ * A pair or query result that shares several cells is only reported from
+ * the first cell they share, so there are no duplicates to weed out.
+ *
+ * SweepAndPrune is the alternative for things that are all about the same
+ * size or spread along one axis: boxes kept in order of their left edge,
+ * re-sorted with an insertion sort that's close to linear when little has
+ * moved since last time. It compares edges directly rather than going
+ * through aabb_intersect, so boxes that exactly touch can come out either
+ * way from the grid's answer by a rounding error.
+ *
+ * Everything comes out of an arena and is fixed size.
+ */
+
+typedef struct BroadphasePair_
+{
+	i32 a, b;
+} BroadphasePair;
+
+typedef struct BroadphaseNode_
+{
+	i32 item;
+	i32 next;
+	i32 cell_x, cell_y;
+} BroadphaseNode;
+
+typedef struct BroadphaseItem_
+{
+	Rect2 box;
+	//Cells covered, inclusive
+	i32 x1, y1, x2, y2;
+	i32 active;
+} BroadphaseItem;
+
+typedef struct Broadphase_
+{
+	f32 inv_cell_size;
+
+	//Head node of each bucket, -1 if empty; a power of two of them
+	i32* buckets;
+	i32 bucket_mask;
+
+	BroadphaseNode* nodes;
+	i32 node_capacity;
+	i32 node_count;
+	i32 free_node;
+
+	BroadphaseItem* items;
+	i32 item_capacity;
+	//One past the highest item inserted
+	i32 item_end;
+} Broadphase;
+
+void broadphase_clear(Broadphase* bp)
+{
+	memset(bp->buckets, 0xFF, sizeof(i32) * (bp->bucket_mask + 1));
+	memset(bp->items, 0, sizeof(BroadphaseItem) * bp->item_capacity);
+	bp->node_count = 0;
+	bp->free_node = -1;
+	bp->item_end = 0;
+}
+
+//node_capacity is how many (item, cell) entries fit; at least item_capacity,
+//more if boxes often straddle cells
+void broadphase_init(Broadphase* bp, MemoryArena* arena, i32 item_capacity, i32 node_capacity, f32 cell_size)
+{
+	bp->inv_cell_size = 1.0f / cell_size;
+	i32 bucket_count = 16;
+	while(bucket_count < node_capacity) bucket_count *= 2;
+	bp->buckets = arena_push(arena, sizeof(i32) * bucket_count);
+	bp->bucket_mask = bucket_count - 1;
+	bp->nodes = arena_push(arena, sizeof(BroadphaseNode) * node_capacity);
+	bp->node_capacity = node_capacity;
+	bp->items = arena_push(arena, sizeof(BroadphaseItem) * item_capacity);
+	bp->item_capacity = item_capacity;
+	broadphase_clear(bp);
+}
+
+static inline
+i32 broadphase_cell(Broadphase* bp, f32 x)
+{
+	return (i32)floorf(x * bp->inv_cell_size);
+}
+
+static inline
+i32 broadphase_bucket(Broadphase* bp, i32 x, i32 y)
+{
+	return (i32)(((u32)x * 73856093u) ^ ((u32)y * 19349663u)) & bp->bucket_mask;
+}
+
+static
+void broadphase_cells_for(Broadphase* bp, const Rect2* box, i32* x1, i32* y1, i32* x2, i32* y2)
+{
+	*x1 = broadphase_cell(bp, AABBp_x1(box));
+	*y1 = broadphase_cell(bp, AABBp_y1(box));
+	*x2 = broadphase_cell(bp, AABBp_x2(box));
+	*y2 = broadphase_cell(bp, AABBp_y2(box));
+}
+
+static inline
+i32 broadphase_item_cells(BroadphaseItem* it)
+{
+	return (it->x2 - it->x1 + 1) * (it->y2 - it->y1 + 1);
+}
+
+//Returns how many cells it linked: all of them, unless it ran out of nodes
+static
+i32 broadphase_link(Broadphase* bp, BroadphaseItem* it, i32 item)
+{
+	i32 linked = 0;
+	for(i32 y = it->y1; y <= it->y2; ++y) {
+		for(i32 x = it->x1; x <= it->x2; ++x) {
+			i32 index = bp->free_node;
+			if(index != -1) {
+				bp->free_node = bp->nodes[index].next;
+			} else if(bp->node_count < bp->node_capacity) {
+				index = bp->node_count++;
+			} else {
+				return linked;
+			}
+			BroadphaseNode* node = bp->nodes + index;
+			i32 bucket = broadphase_bucket(bp, x, y);
+			node->item = item;
+			node->cell_x = x;
+			node->cell_y = y;
+			node->next = bp->buckets[bucket];
+			bp->buckets[bucket] = index;
+			linked++;
+		}
+	}
+	return linked;
+}
+
+//The first cell_count of the item's cells, in the order broadphase_link
+//links them
+static
+void broadphase_unlink(Broadphase* bp, BroadphaseItem* it, i32 item, i32 cell_count)
+{
+	for(i32 y = it->y1; y <= it->y2; ++y) {
+		for(i32 x = it->x1; x <= it->x2; ++x) {
+			if(cell_count-- <= 0) return;
+			i32* link = bp->buckets + broadphase_bucket(bp, x, y);
+			while(*link != -1) {
+				BroadphaseNode* node = bp->nodes + *link;
+				if(node->item == item && node->cell_x == x && node->cell_y == y) {
+					i32 index = *link;
+					*link = node->next;
+					node->next = bp->free_node;
+					bp->free_node = index;
+					break;
+				}
+				link = &node->next;
+			}
+		}
+	}
+}
+
+void broadphase_remove(Broadphase* bp, i32 item)
+{
+	if(item < 0 || item >= bp->item_capacity) return;
+	BroadphaseItem* it = bp->items + item;
+	if(!it->active) return;
+	broadphase_unlink(bp, it, item, broadphase_item_cells(it));
+	it->active = false;
+}
+
+//Inserting an item that's already in moves it. Returns false if the item
+//is out of range or there weren't enough nodes; then it isn't in at all.
+i32 broadphase_insert(Broadphase* bp, i32 item, const Rect2* box)
+{
+	if(item < 0 || item >= bp->item_capacity) {
+		log_error("Error: broadphase item %d out of range", item);
+		return false;
+	}
+	BroadphaseItem* it = bp->items + item;
+	if(it->active) broadphase_unlink(bp, it, item, broadphase_item_cells(it));
+
+	it->box = *box;
+	broadphase_cells_for(bp, box, &it->x1, &it->y1, &it->x2, &it->y2);
+	it->active = true;
+	i32 linked = broadphase_link(bp, it, item);
+	if(linked < broadphase_item_cells(it)) {
+		log_error("Error: broadphase ran out of nodes (%d)", bp->node_capacity);
+		broadphase_unlink(bp, it, item, linked);
+		it->active = false;
+		return false;
+	}
+	if(item >= bp->item_end) bp->item_end = item + 1;
+	return true;
+}
+
+//Only goes near the buckets if the box has moved into different cells
+i32 broadphase_update(Broadphase* bp, i32 item, const Rect2* box)
+{
+	if(item >= 0 && item < bp->item_capacity && bp->items[item].active) {
+		BroadphaseItem* it = bp->items + item;
+		i32 x1, y1, x2, y2;
+		broadphase_cells_for(bp, box, &x1, &y1, &x2, &y2);
+		if(x1 == it->x1 && y1 == it->y1 && x2 == it->x2 && y2 == it->y2) {
+			it->box = *box;
+			return true;
+		}
+	}
+	return broadphase_insert(bp, item, box);
+}
+
+//Writes up to max items whose boxes touch region to out; returns how many
+i32 broadphase_query(Broadphase* bp, const Rect2* region, i32* out, i32 max)
+{
+	i32 x1, y1, x2, y2;
+	broadphase_cells_for(bp, region, &x1, &y1, &x2, &y2);
+	i32 count = 0;
+	for(i32 y = y1; y <= y2; ++y) {
+		for(i32 x = x1; x <= x2; ++x) {
+			for(i32 index = bp->buckets[broadphase_bucket(bp, x, y)]; index != -1; index = bp->nodes[index].next) {
+				BroadphaseNode* node = bp->nodes + index;
+				if(node->cell_x != x || node->cell_y != y) continue;
+				BroadphaseItem* it = bp->items + node->item;
+				//Only from the first cell the item and region share
+				if(x != (it->x1 > x1 ? it->x1 : x1) || y != (it->y1 > y1 ? it->y1 : y1)) continue;
+				if(!aabb_intersect(region, &it->box)) continue;
+				if(count >= max) return count;
+				out[count++] = node->item;
+			}
+		}
+	}
+	return count;
+}
+
+static inline
+i32 broadphase_query_point(Broadphase* bp, Vec2 point, i32* out, i32 max)
+{
+	Rect2 region = rect2_v(point, v2(0, 0));
+	return broadphase_query(bp, &region, out, max);
+}
+
+//Writes up to max overlapping pairs to out, with a < b; returns how many
+i32 broadphase_pairs(Broadphase* bp, BroadphasePair* out, i32 max)
+{
+	i32 count = 0;
+	for(i32 i = 0; i < bp->item_end; ++i) {
+		BroadphaseItem* a = bp->items + i;
+		if(!a->active) continue;
+		for(i32 y = a->y1; y <= a->y2; ++y) {
+			for(i32 x = a->x1; x <= a->x2; ++x) {
+				for(i32 index = bp->buckets[broadphase_bucket(bp, x, y)]; index != -1; index = bp->nodes[index].next) {
+					BroadphaseNode* node = bp->nodes + index;
+					if(node->item <= i || node->cell_x != x || node->cell_y != y) continue;
+					BroadphaseItem* b = bp->items + node->item;
+					if(x != (a->x1 > b->x1 ? a->x1 : b->x1) || y != (a->y1 > b->y1 ? a->y1 : b->y1)) continue;
+					if(!aabb_intersect(&a->box, &b->box)) continue;
+					if(count >= max) return count;
+					out[count].a = i;
+					out[count].b = node->item;
+					count++;
+				}
+			}
+		}
+	}
+	return count;
+}
+
+
+typedef struct SweepAndPrune_
+{
+	Rect2* boxes;
+	i32 capacity;
+	i32 count;
+	//Items sorted by left edge, as of the last sweep
+	i32* order;
+	i32 order_count;
+} SweepAndPrune;
+
+void sap_init(SweepAndPrune* sap, MemoryArena* arena, i32 capacity)
+{
+	sap->boxes = arena_push(arena, sizeof(Rect2) * capacity);
+	sap->order = arena_push(arena, sizeof(i32) * capacity);
+	sap->capacity = capacity;
+	sap->count = 0;
+	sap->order_count = 0;
+}
+
+//Items are 0 to count - 1; setting one past the end adds it
+void sap_set(SweepAndPrune* sap, i32 item, const Rect2* box)
+{
+	if(item < 0 || item > sap->count || item >= sap->capacity) {
+		log_error("Error: sweep and prune item %d out of range (%d so far)", item, sap->count);
+		return;
+	}
+	if(item == sap->count) {
+		sap->order[sap->order_count++] = sap->count++;
+	}
+	sap->boxes[item] = *box;
+}
+
+void sap_clear(SweepAndPrune* sap)
+{
+	sap->count = 0;
+	sap->order_count = 0;
+}
+
+//Insertion sort, since the order is usually nearly right already
+static
+void sap_sort(SweepAndPrune* sap)
+{
+	i32* order = sap->order;
+	for(i32 i = 1; i < sap->order_count; ++i) {
+		i32 item = order[i];
+		f32 left = AABB_x1(sap->boxes[item]);
+		i32 j = i - 1;
+		while(j >= 0 && AABB_x1(sap->boxes[order[j]]) > left) {
+			order[j + 1] = order[j];
+			j--;
+		}
+		order[j + 1] = item;
+	}
+}
+
+i32 sap_pairs(SweepAndPrune* sap, BroadphasePair* out, i32 max)
+{
+	sap_sort(sap);
+	i32 count = 0;
+	for(i32 i = 0; i < sap->order_count; ++i) {
+		i32 a = sap->order[i];
+		Rect2* box = sap->boxes + a;
+		f32 right = AABBp_x2(box);
+		for(i32 j = i + 1; j < sap->order_count; ++j) {
+			i32 b = sap->order[j];
+			Rect2* other = sap->boxes + b;
+			if(AABBp_x1(other) > right) break;
+			if(AABBp_y1(other) > AABBp_y2(box) || AABBp_y1(box) > AABBp_y2(other)) continue;
+			if(count >= max) return count;
+			out[count].a = a < b ? a : b;
+			out[count].b = a < b ? b : a;
+			count++;
+		}
+	}
+	return count;
+}
+
+i32 sap_query(SweepAndPrune* sap, const Rect2* region, i32* out, i32 max)
+{
+	sap_sort(sap);
+	f32 right = AABBp_x2(region);
+	i32 count = 0;
+	for(i32 i = 0; i < sap->order_count; ++i) {
+		i32 item = sap->order[i];
+		Rect2* box = sap->boxes + item;
+		if(AABBp_x1(box) > right) break;
+		if(AABBp_x2(box) < AABBp_x1(region) || 
+				AABBp_y1(box) > AABBp_y2(region) || AABBp_y1(region) > AABBp_y2(box)) continue;
+		if(count >= max) break;
+		out[count++] = item;
+	}
+	return count;
+}
+
@@ -0,0 +1,195 @@
+
+/* Entities
+ *
+ * An Entity is just an index into an EntityStore. Each component field is
+ * its own array, and components[e] says which components entity e has, so a
+ * system only streams through the arrays it actually uses; easing scales
+ * touches two floats an entity rather than a whole Sprite. Every array is
+ * pushed on an arena up front for capacity entities, and destroyed ones go
+ * on a free list to be handed out again.
+ *
+ * entity_render_sprites writes instances straight into a SpriteGroup,
+ * texture rects already divided down to 0 to 1, rather than building a
+ * Sprite to pass to render_add for each one.
+ */
+
+typedef i32 Entity;
+#define EntityNone -1
+
+typedef enum EntityComponent_
+{
+	//pos, size, angle, scale
+	Component_Transform = Flag(0),
+	//texture, color, sprite_flags
+	Component_Sprite = Flag(1),
+	Component_Cell = Flag(2),
+	Component_Kind = Flag(3),
+	//Set on everything that hasn't been destroyed
+	Component_Alive = Flag(31)
+} EntityComponent;
+
+typedef struct EntityStore_
+{
+	u32* components;
+
+	Vec2* pos;
+	Vec2* size;
+	f32* angle;
+	//Scaled about the sprite's middle; last_scale is the previous tick's,
+	//for interpolating
+	f32* scale;
+	f32* last_scale;
+
+	//In pixels, like Sprite.texture
+	Rect2* texture;
+	Color* color;
+	u32* sprite_flags;
+
+	Vec2i* cell;
+	i32* kind;
+
+	//Entities ever created; the arrays are good up to here
+	isize count;
+	isize capacity;
+	Entity* free_list;
+	isize free_count;
+} EntityStore;
+
+//Returns false if the arena's too small
+i32 entity_store_init(EntityStore* store, MemoryArena* arena, isize capacity)
+{
+	memset(store, 0, sizeof(EntityStore));
+	store->capacity = capacity;
+	store->components = arena_push(arena, sizeof(u32) * capacity);
+	store->pos = arena_push(arena, sizeof(Vec2) * capacity);
+	store->size = arena_push(arena, sizeof(Vec2) * capacity);
+	store->angle = arena_push(arena, sizeof(f32) * capacity);
+	store->scale = arena_push(arena, sizeof(f32) * capacity);
+	store->last_scale = arena_push(arena, sizeof(f32) * capacity);
+	store->texture = arena_push(arena, sizeof(Rect2) * capacity);
+	store->color = arena_push(arena, sizeof(Color) * capacity);
+	store->sprite_flags = arena_push(arena, sizeof(u32) * capacity);
+	store->cell = arena_push(arena, sizeof(Vec2i) * capacity);
+	store->kind = arena_push(arena, sizeof(i32) * capacity);
+	store->free_list = arena_push(arena, sizeof(Entity) * capacity);
+	return store->free_list != NULL;
+}
+
+static inline
+i32 entity_has(EntityStore* store, Entity e, u32 components)
+{
+	return (store->components[e] & components) == components;
+}
+
+//Every field starts like sprite_init would have it. EntityNone if it's full.
+Entity entity_create(EntityStore* store, u32 components)
+{
+	Entity e;
+	if(store->free_count > 0) {
+		e = store->free_list[--store->free_count];
+	} else if(store->count < store->capacity) {
+		e = store->count++;
+	} else {
+		log_error("Error: EntityStore is full (%d)", (i32)store->capacity);
+		return EntityNone;
+	}
+
+	store->components[e] = components | Component_Alive;
+	store->pos[e] = v2(0, 0);
+	store->size[e] = v2(16, 16);
+	store->angle[e] = 0;
+	store->scale[e] = store->last_scale[e] = 1;
+	store->texture[e] = rect2(0, 0, 1, 1);
+	store->color[e] = create_color(1, 1, 1, 1);
+	store->sprite_flags[e] = Anchor_Center;
+	store->cell[e] = v2i(0, 0);
+	store->kind[e] = 0;
+	return e;
+}
+
+void entity_destroy(EntityStore* store, Entity e)
+{
+	if(!HasFlag(store->components[e], Component_Alive)) return;
+	store->components[e] = 0;
+	store->free_list[store->free_count++] = e;
+}
+
+void entity_store_clear(EntityStore* store)
+{
+	store->count = 0;
+	store->free_count = 0;
+}
+
+//Moves every transform's scale ease of the way towards 1, or hot_scale for
+//hot (which can be EntityNone)
+void entity_ease_scales(EntityStore* store, Entity hot, f32 hot_scale, f32 ease)
+{
+	u32* components = store->components;
+	f32* scale = store->scale;
+	f32* last_scale = store->last_scale;
+	for(isize i = 0; i < store->count; ++i) {
+		if(!HasFlag(components[i], Component_Transform)) continue;
+		f32 target = i == hot ? hot_scale : 1.0f;
+		last_scale[i] = scale[i];
+		scale[i] += (target - scale[i]) * ease;
+	}
+}
+
+//Adds a sprite for everything with a transform and a sprite, in entity
+//order, scale interpolated by alpha. Returns how many went in; stops early
+//if the group fills up.
+isize entity_render_sprites(EntityStore* store, SpriteGroup* group, f32 alpha)
+{
+	//All in locals, so the compiler doesn't reload them after every write
+	//to the group in case they alias
+	const u32* components = store->components;
+	const Vec2* pos_in = store->pos;
+	const Vec2* size_in = store->size;
+	const f32* angle = store->angle;
+	const f32* scale_in = store->scale;
+	const f32* last_scale = store->last_scale;
+	const Rect2* texture_in = store->texture;
+	const Color* color = store->color;
+	const u32* sprite_flags = store->sprite_flags;
+	isize count = store->count;
+
+	u32 needed = Component_Transform | Component_Sprite;
+	f32 inv_width = 1.0f / group->texture_width;
+	f32 inv_height = 1.0f / group->texture_height;
+	Sprite* out = group->sprites + group->count;
+	isize room = group->capacity - group->count;
+	isize added = 0;
+
+	for(isize i = 0; i < count && added < room; ++i) {
+		if((components[i] & needed) != needed) continue;
+		Sprite s;
+		s.pos = pos_in[i];
+		s.size = size_in[i];
+		s.flags = sprite_flags[i];
+
+		f32 scale = last_scale[i] + (scale_in[i] - last_scale[i]) * alpha;
+		if(scale != 1.0f) {
+			//Scale about the middle, wherever it was anchored
+			u32 anchor = s.flags & SpriteAnchorMask;
+			s.pos.x -= s.size.x * SpriteAnchorX[anchor];
+			s.pos.y -= s.size.y * SpriteAnchorY[anchor];
+			s.size.x *= scale;
+			s.size.y *= scale;
+			s.flags = (s.flags & ~SpriteAnchorMask) | Anchor_Center;
+		}
+
+		Rect2 texture = texture_in[i];
+		s.center = v2(0, 0);
+		s.texture.pos.x = texture.pos.x * inv_width;
+		s.texture.pos.y = texture.pos.y * inv_height;
+		s.texture.size.x = texture.size.x * inv_width;
+		s.texture.size.y = texture.size.y * inv_height;
+		s.color = color[i];
+		s.angle = angle[i];
+		out[added++] = s;
+	}
+
+	group->count += added;
+	return added;
+}
+
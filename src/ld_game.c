@@ -18,9 +18,36 @@ typedef struct GameSettings_
 	string vert_shader;
 	string frag_shader;
 	string texture_file;
+	string music_file;
+	//Loaded into the sound bank at startup; a sound's id is its index here
+	string* sound_files;
+	i32 sound_count;
 
 	string archive_name;
 
+	//Time per frame spent uploading streamed assets to the GPU
+	f32 asset_budget_ms;
+
+	//Simulation ticks per second; update always gets 1 / tick_rate
+	f32 tick_rate;
+	i32 vsync;
+	//Frames per second cap, used when there's no vsync. 0 picks the display's
+	//refresh rate (or 60 if SDL doesn't know it)
+	f32 frame_limit;
+
+	//Session log to write, or to play back instead of live input; can be NULL.
+	//Replays run one tick per frame, without vsync, as fast as they can.
+	string record_input;
+	string replay_input;
+
+	//For the room layout; a replay uses the seed it was recorded with
+	u64 seed;
+
+	//--bench: run this many frames uncapped, one tick each, then print timings.
+	//bench_hidden renders to an offscreen framebuffer behind a hidden window.
+	i32 bench_frames;
+	i32 bench_hidden;
+
 } GameSettings;
 
 typedef struct GameHandle_
@@ -42,20 +69,35 @@ typedef struct GameHandle_
 	string base_path;
 	string pref_path;
 
-	mz_zip_archive assets;
-
-	i32* keys;
+	AssetPack assets;
+	JobSystem* jobs;
+	AssetStreamer* streamer;
+#ifdef WB_DEBUG
+	HotReloader* hotreload;
+#endif
+
+	InputState* input;
+
+	i32 vsync;
+	f32 frame_limit;
+	u64 seed;
+	i32 replaying;
+	Profiler* profiler;
+	u32 offscreen_framebuffer;
+	u64 tick_count;
+	u64 frame_count;
 	
 } GameHandle;
 
+typedef void (*GameUpdateProc)(GameHandle* game, f32 dt);
+typedef void (*GameDrawProc)(GameHandle* game, f32 alpha);
 
 
+
+//Borrowed from the asset pack; don't free it
 void* game_get_asset(GameHandle* game, string asset_name, isize* size_out)
 {
-	usize len = 0;
-	void* asset = mz_zip_reader_extract_file_to_heap(&game->assets, asset_name, &len, 0);
-	*size_out = len;
-	return asset;
+	return asset_pack_get(&game->assets, asset_name, size_out);
 }
 
 void game_update_screen(GameHandle* game)
@@ -73,12 +115,58 @@ void game_set_scale(GameHandle* game, f32 scale)
 }
 
 
+//A hidden window's default framebuffer may not be rendered at all, so draw
+//into our own instead; nothing else binds framebuffers, so it stays bound
+static
+u32 game_create_offscreen_framebuffer(Vec2i size)
+{
+	u32 framebuffer, color;
+	glGenFramebuffers(1, &framebuffer);
+	glGenRenderbuffers(1, &color);
+	glBindRenderbuffer(GL_RENDERBUFFER, color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size.x, size.y);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+	u32 status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if(status != GL_FRAMEBUFFER_COMPLETE) {
+		log_error("Error: offscreen framebuffer is incomplete (0x%x), drawing to the window instead", status);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &color);
+		return 0;
+	}
+	return framebuffer;
+}
+
+static
+void game_texture_ready(AssetRequest* request, void* userdata)
+{
+	GameHandle* game = userdata;
+	sprite_renderer_set_texture(game->renderer, request->texture, request->width, request->height);
+}
+
+static
+void game_bench_init(GameHandle* game, AssetHandle texture)
+{
+	GameSettings* settings = game->settings;
+	i32 frames = settings->bench_frames;
+	MemoryArena* arena = arena_bootstrap("ProfileArena", 
+			sizeof(Profiler) + sizeof(u64) * frames * (ProfileZone_Count + 1) + 64);
+	game->profiler = profiler_create(arena, frames);
+	if(settings->bench_hidden) {
+		game->offscreen_framebuffer = game_create_offscreen_framebuffer(settings->window_size);
+	}
+	//Same work every frame from the first one
+	asset_stream_wait(game->streamer, texture);
+}
+
 GameHandle* game_init(GameSettings* settings)
 {
 	if(SDL_Init(SDL_INIT_EVERYTHING) != 0) {
 		log_error("Error: failed to init SDL: %s", SDL_GetError());
 		return NULL;
 	}
+	batch_init();
 
 	SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
 	SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
@@ -97,9 +185,10 @@ GameHandle* game_init(GameSettings* settings)
 			SDL_WINDOWPOS_CENTERED_DISPLAY(settings->display_index),
 			settings->window_size.x, settings->window_size.y,
 			SDL_WINDOW_OPENGL | 
-			SDL_WINDOW_RESIZABLE |
-			SDL_WINDOW_MOUSE_FOCUS |
-			SDL_WINDOW_INPUT_FOCUS);
+			(settings->bench_frames > 0 && settings->bench_hidden ? SDL_WINDOW_HIDDEN :
+			 SDL_WINDOW_RESIZABLE |
+			 SDL_WINDOW_MOUSE_FOCUS |
+			 SDL_WINDOW_INPUT_FOCUS));
 
 	if(window == NULL) {
 		log_error("Error: could not create window: %s", SDL_GetError());
@@ -108,19 +197,18 @@ GameHandle* game_init(GameSettings* settings)
 
 	SDL_GLContext opengl_context = SDL_GL_CreateContext(window);
 	if(!gladLoadGL()) {
-		log_error("Error: could not load OpenGL functions");
+		log_error("Error: could not load OpenGL functions: %s", SDL_GetError());
 		return NULL;
 	}
 
-	i32 error = SDL_GL_SetSwapInterval(1);
-	if(error == -1) {
-		error = SDL_GL_SetSwapInterval(1);
-		if(error == -1) {
-			error = SDL_GL_SetSwapInterval(0);
-		}
-
+	i32 vsync = false;
+	if(settings->vsync && settings->bench_frames <= 0) {
+		//Late swap tearing first, then plain vsync
+		vsync = SDL_GL_SetSwapInterval(-1) == 0 || SDL_GL_SetSwapInterval(1) == 0;
+	}
+	if(!vsync) {
+		SDL_GL_SetSwapInterval(0);
 	}
-
 
 	MemoryArena* game_arena = arena_bootstrap("GameArena", Megabytes(1));
 	GameHandle* game = arena_push(game_arena, sizeof(GameHandle));
@@ -134,114 +222,240 @@ GameHandle* game_init(GameSettings* settings)
 	game->display_size.y = game->window_size.y * game->scale;
 
 	game->base_path = SDL_GetBasePath();
-	game->pref_path = NULL;
-	//game->pref_path = SDL_GetPrefPath("WilliamBundy", "LD37");
+	game->pref_path = SDL_GetPrefPath("WilliamBundy", "LD37");
 
 	game->game_arena = game_arena;
 	game->render_arena = arena_bootstrap("RenderArena", Megabytes(256));
 	game->play_arena = arena_bootstrap("PlayArena", Megabytes(256));
 
-	game->keys = arena_push(game->game_arena, sizeof(i32) * SDL_NUM_SCANCODES);
+	//Without vsync nothing else stops the loop spinning flat out, which is
+	//only what we want when benchmarking
+	game->vsync = vsync;
+	game->frame_limit = settings->frame_limit;
+	if(settings->bench_frames > 0) {
+		game->frame_limit = 0;
+	} else if(!vsync && game->frame_limit <= 0) {
+		SDL_DisplayMode mode;
+		game->frame_limit = 60;
+		if(SDL_GetCurrentDisplayMode(settings->display_index, &mode) == 0 && mode.refresh_rate > 0) {
+			game->frame_limit = mode.refresh_rate;
+		}
+	}
+
+	game->input = arena_push(game->game_arena, sizeof(InputState));
+	input_init(game->input);
+	game->seed = settings->seed;
+	if(settings->replay_input != NULL) {
+		InputLogHeader header;
+		if(!input_replay_start(game->input, settings->replay_input, &header)) {
+			return NULL;
+		}
+		game->replaying = true;
+		game->seed = header.seed;
+		settings->tick_rate = header.tick_rate;
+		SDL_GL_SetSwapInterval(0);
+		game->vsync = false;
+		game->frame_limit = 0;
+	} else if(settings->record_input != NULL) {
+		input_record_start(game->input, settings->record_input, game->seed, settings->tick_rate);
+	}
 
-	char* vertex_src;
-	char* frag_src;
 
 	{
-		mz_zip_archive zip = {0};
 		char fn_buf[4096];
 		snprintf(fn_buf, 4096, "%s%s", game->base_path, settings->archive_name);
-
-		i32 result = mz_zip_reader_init_file(&zip, fn_buf, MZ_ZIP_FLAG_COMPRESSED_DATA);
-
-		if(!result) {
+		if(!asset_pack_open(&game->assets, fn_buf)) {
 			log_error("Could not open archive %s. Please locate game archive and try again", settings->archive_name);
 			return NULL;
 		}
-
-		usize len = 0;
-
-		vertex_src = mz_zip_reader_extract_file_to_heap(&zip, settings->vert_shader, &len, 0);
-		vertex_src[len-1] = '\0';
-
-		len = 0;
-		frag_src = mz_zip_reader_extract_file_to_heap(&zip, settings->frag_shader, &len, 0);
-		frag_src[len - 1] = '\0';
-		game->assets = zip;
 	}
 
+	//The texture decodes on the job workers while the shaders compile, and
+	//gets uploaded by asset_streamer_finalize once it's ready
 	game->renderer = arena_push(game->game_arena, sizeof(SpriteRenderer));
 	sprite_renderer_init_groups(game->renderer, 8, 
 			200000, 
 			game->render_arena);
-	
-	sprite_renderer_init_gl(game->renderer, vertex_src, frag_src);
-	
-	{
-		u32 texture;
-		i32 w, h;
-		isize newlen;
-		u8* raw_image = mz_zip_reader_extract_file_to_heap(&game->assets, settings->texture_file, &newlen, 0);
-		texture = ogl_load_texture_from_memory(raw_image, newlen,  &w, &h);
-		sprite_renderer_set_texture(game->renderer, texture, w, h);
+	game->renderer->program_cache_dir = game->pref_path;
+
+	game->jobs = arena_push(game->game_arena, sizeof(JobSystem));
+	job_system_init(game->jobs, 0, arena_bootstrap("JobArena", sizeof(Job) * JobDequeSize * JobMaxThreads));
+	game->streamer = arena_push(game->game_arena, sizeof(AssetStreamer));
+	asset_streamer_init(game->streamer, &game->assets, game->jobs, game->game_arena);
+	AssetHandle vert = asset_stream_raw(game->streamer, settings->vert_shader, NULL, NULL);
+	AssetHandle frag = asset_stream_raw(game->streamer, settings->frag_shader, NULL, NULL);
+	AssetHandle texture = asset_stream_texture(game->streamer, settings->texture_file, game_texture_ready, game);
+
+	AssetRequest* vertex_src = asset_stream_wait(game->streamer, vert);
+	AssetRequest* frag_src = asset_stream_wait(game->streamer, frag);
+	if(vertex_src == NULL || frag_src == NULL) {
+		return NULL;
 	}
+	
+	sprite_renderer_init_gl(game->renderer, vertex_src->data, frag_src->data);
 
 	game->current_group = game->renderer->groups;
+
+	init_audio(game->game_arena);
+	sound_bank_init(&sound_bank, arena_bootstrap("SoundArena", SoundBankBytes), SoundBankBytes);
+	for(i32 i = 0; i < settings->sound_count; ++i) {
+		isize sound_size = 0;
+		void* sound_data = game_get_asset(game, settings->sound_files[i], &sound_size);
+		sound_bank_load(&sound_bank, settings->sound_files[i], sound_data, sound_size);
+	}
+	if(settings->music_file != NULL) {
+		isize music_size;
+		void* music_data = game_get_asset(game, settings->music_file, &music_size);
+		if(music_data != NULL) {
+			music_play(music_data, music_size, 0.8f, true);
+		}
+	}
+
+#ifdef WB_DEBUG
+	game->hotreload = arena_push(game->game_arena, sizeof(HotReloader));
+	hotreload_init(game->hotreload, game->renderer, 
+			settings->vert_shader, settings->frag_shader, settings->texture_file);
+#endif
+
+	if(settings->bench_frames > 0) {
+		game_bench_init(game, texture);
+	}
 	
 	return game;
 }
 
-typedef enum ButtonState_
-{
-	Button_JustReleased = -1,
-	Button_Released,
-	Button_Pressed,
-	Button_JustPressed
-} ButtonState;
 
 
-i32 game_start(GameHandle* game, void (*update)(GameHandle*))
+/* Main loop
+ *
+ * Simulation runs at a fixed tick rate, decoupled from rendering: real time
+ * is added to an accumulator each frame, and update runs once for every
+ * whole tick in it. draw then gets the leftover fraction of a tick so it can
+ * interpolate between the last two ticks. After a long stall (a breakpoint,
+ * dragging the window), at most GameMaxTicksPerFrame ticks are run and the
+ * rest of the time is dropped, rather than trying to catch up.
+ *
+ * Input edges (JustPressed/JustReleased) are cleared after the first tick
+ * that sees them, so a frame that runs no ticks doesn't lose a press.
+ * Events polled during a frame are stamped with the next tick to run, which
+ * is what makes an input log replay the same way.
+ *
+ * A replay ignores the clock: every frame runs exactly one tick, draws it,
+ * and goes straight on to the next, so two runs of the same log do the
+ * same work. It stops at the end of the log and prints how long it took.
+ * --bench runs the same way for a set number of frames, timing each zone of
+ * the frame, and prints frame time percentiles and a per zone breakdown.
+ */
+#define GameMaxTicksPerFrame 8
+#define GameSpinMarginMs 2
+
+//Sleeps for most of the wait, then spins for the last bit; Sleep/SDL_Delay
+//can overshoot by a millisecond or so even with SDL's 1ms timer resolution
+static
+void game_wait_until(u64 target)
+{
+	u64 freq = SDL_GetPerformanceFrequency();
+	u64 margin = freq * GameSpinMarginMs / 1000;
+	for(;;) {
+		u64 now = SDL_GetPerformanceCounter();
+		if(now >= target) break;
+		u64 remaining = target - now;
+		if(remaining > margin) {
+			SDL_Delay((u32)((remaining - margin) * 1000 / freq));
+		}
+	}
+}
+
+i32 game_start(GameHandle* game, GameUpdateProc update, GameDrawProc draw)
 {
 	i32 running = 1;
 	SDL_Event event;
 	glClearColor(0, 0, 0, 1);
+
+	u64 freq = SDL_GetPerformanceFrequency();
+	f32 tick_rate = game->settings->tick_rate > 0 ? game->settings->tick_rate : 60;
+	u64 tick_length = (u64)(freq / tick_rate);
+	f32 dt = 1.0f / tick_rate;
+	u64 frame_length = game->frame_limit > 0 ? (u64)(freq / game->frame_limit) : 0;
+	u64 accumulator = 0;
+	u64 start_time = SDL_GetPerformanceCounter();
+	u64 last_time = start_time;
+
 	while(running) {
-		for(isize i = 0; i < SDL_NUM_SCANCODES; ++i) {
-			i32* t = game->keys + i;
-			if(*t == Button_JustPressed) {
-				*t = Button_Pressed;
-				printf("->%d\n", i);
-			} else if(*t == Button_JustReleased) {
-				*t = Button_Released;
-				printf("<-%d\n", i);
-			}
+		u64 frame_start = SDL_GetPerformanceCounter();
+		accumulator += frame_start - last_time;
+		last_time = frame_start;
+		if(accumulator > tick_length * GameMaxTicksPerFrame) {
+			accumulator = tick_length * GameMaxTicksPerFrame;
+		}
+		if(game->replaying || game->profiler != NULL) {
+			accumulator = tick_length;
 		}
+		profile_frame_begin(game->profiler);
 
+		profile_begin(game->profiler, Zone_Events);
+		input_begin_frame(game->input, (u32)game->frame_count, (u32)game->tick_count);
 		while(SDL_PollEvent(&event)) {
-			switch(event.type) {
-				case SDL_QUIT:
-					running = false;
-					break;
-				case SDL_KEYDOWN:
-					if(!event.key.repeat) {
-						printf("Keydown!\n");
-						game->keys[event.key.keysym.scancode] = Button_JustPressed;
-					}
-					break;
-				case SDL_KEYUP:
-					if(!event.key.repeat) {
-						printf("Keyup!\n");
-						game->keys[event.key.keysym.scancode] = Button_JustReleased;
-					}
-					break;
+			if(event.type == SDL_QUIT) {
+				running = false;
 			}
+			input_handle_event(game->input, &event);
 		}
+		profile_end(game->profiler, Zone_Events);
+
+		profile_begin(game->profiler, Zone_Streaming);
+		asset_streamer_finalize(game->streamer, game->settings->asset_budget_ms);
+#ifdef WB_DEBUG
+		hotreload_poll(game->hotreload);
+#endif
+		profile_end(game->profiler, Zone_Streaming);
+
+		profile_begin(game->profiler, Zone_Update);
+		while(accumulator >= tick_length) {
+			input_begin_tick(game->input, (u32)game->tick_count);
+			update(game, dt);
+			input_end_tick(game->input);
+			accumulator -= tick_length;
+			game->tick_count++;
+		}
+		profile_end(game->profiler, Zone_Update);
 
+		profile_begin(game->profiler, Zone_Draw);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		game_update_screen(game);
-		(*update)(game);
+		draw(game, (f32)accumulator / (f32)tick_length);
+		profile_end(game->profiler, Zone_Draw);
+
+		//With nothing to swap, wait for the GPU so its time still counts
+		profile_begin(game->profiler, Zone_Present);
+		if(game->offscreen_framebuffer != 0) {
+			glFinish();
+		} else {
+			SDL_GL_SwapWindow(game->window);
+		}
+		profile_end(game->profiler, Zone_Present);
+		profile_frame_end(game->profiler);
+		game->frame_count++;
 
-		SDL_GL_SwapWindow(game->window);
+		if(profiler_done(game->profiler)) {
+			profiler_report(game->profiler, (f64)(SDL_GetPerformanceCounter() - start_time) / freq);
+			running = false;
+		}
+
+		if(game->replaying && input_replay_finished(game->input)) {
+			f64 seconds = (f64)(SDL_GetPerformanceCounter() - start_time) / freq;
+			printf("Replay: %llu ticks in %.3fs, %.3fms per frame, %.1f fps\n",
+					(unsigned long long)game->tick_count, seconds, 
+					seconds * 1000.0 / game->frame_count, game->frame_count / seconds);
+			running = false;
+		} else if(frame_length > 0) {
+			game_wait_until(frame_start + frame_length);
+		}
 	}
+	input_close(game->input);
+	audio_shutdown();
+	asset_streamer_shutdown(game->streamer);
+	job_system_shutdown(game->jobs);
 	SDL_Quit();
 	return 0;
 }
@@ -0,0 +1,319 @@
+
+/* Hot reloading for debug builds
+ *
+ * Watches the directories the shaders and texture live in (relative to the
+ * working directory, which is the repo root when run from make.bat) and
+ * rebuilds whatever changed straight from the source files, skipping the
+ * pack entirely.
+ *
+ * Everything built is kept in a small cache keyed by a hash of the file
+ * contents, so saving a file without changing it does nothing, and flipping
+ * back to an earlier version swaps the old GL object back in without
+ * decoding or compiling anything. The cache owns what's in it, the objects
+ * loaded at startup included; anything that drops out of it while it's
+ * live gets deleted once something else is swapped in.
+ */
+
+#define HotReloadMaxFiles 16
+#define HotReloadMaxCache 64
+
+typedef enum HotReloadKind_
+{
+	HotReload_Shader,
+	HotReload_Texture
+} HotReloadKind;
+
+typedef struct HotReloadFile_
+{
+	string path;
+	HotReloadKind kind;
+	i32 dirty;
+} HotReloadFile;
+
+typedef struct HotReloadCacheEntry_
+{
+	u64 hash;
+	HotReloadKind kind;
+	u32 object;
+	i32 width;
+	i32 height;
+} HotReloadCacheEntry;
+
+typedef struct HotReloader_
+{
+	PlatformWatcher* watcher;
+	SpriteRenderer* renderer;
+
+	string vert_path;
+	string frag_path;
+	string texture_path;
+
+	HotReloadFile files[HotReloadMaxFiles];
+	i32 file_count;
+	char dirs[HotReloadMaxFiles][256];
+	i32 dir_count;
+
+	//Content hash of what's currently live
+	u64 shader_hash;
+	u64 texture_hash;
+
+	HotReloadCacheEntry cache[HotReloadMaxCache];
+	i32 cache_count;
+} HotReloader;
+
+static
+u64 hotreload_hash_file(string path, u64 hash, char** data_out, isize* size_out)
+{
+	isize size = 0;
+	char* data = platform_read_file(path, &size,
+			allocator_create(platform_malloc_wrapper, platform_free_wrapper, NULL, NULL));
+	if(data == NULL) {
+		if(data_out != NULL) *data_out = NULL;
+		return 0;
+	}
+	hash = hash_fnv64(data, size, hash);
+	if(data_out != NULL) {
+		*data_out = data;
+	} else {
+		free(data);
+	}
+	if(size_out != NULL) *size_out = size;
+	return hash;
+}
+
+static
+HotReloadCacheEntry* hotreload_cache_find(HotReloader* r, HotReloadKind kind, u64 hash)
+{
+	isize count = r->cache_count < HotReloadMaxCache ? r->cache_count : HotReloadMaxCache;
+	for(isize i = 0; i < count; ++i) {
+		HotReloadCacheEntry* e = r->cache + i;
+		if(e->kind == kind && e->hash == hash) {
+			return e;
+		}
+	}
+	return NULL;
+}
+
+static
+u32 hotreload_live_object(HotReloader* r, HotReloadKind kind)
+{
+	return kind == HotReload_Shader ? r->renderer->shaders : r->renderer->groups[0].texture;
+}
+
+static
+void hotreload_delete_object(HotReloadKind kind, u32 object)
+{
+	if(kind == HotReload_Shader) {
+		glDeleteProgram(object);
+	} else {
+		glDeleteTextures(1, &object);
+	}
+}
+
+static
+i32 hotreload_cache_holds(HotReloader* r, HotReloadKind kind, u32 object)
+{
+	isize count = r->cache_count < HotReloadMaxCache ? r->cache_count : HotReloadMaxCache;
+	for(isize i = 0; i < count; ++i) {
+		if(r->cache[i].kind == kind && r->cache[i].object == object) return true;
+	}
+	return false;
+}
+
+static
+HotReloadCacheEntry* hotreload_cache_insert(HotReloader* r, HotReloadKind kind, u64 hash)
+{
+	//Oldest entry goes once the cache is full; if that's what's live, it's
+	//deleted when it gets swapped out instead
+	HotReloadCacheEntry* e = r->cache + (r->cache_count++ % HotReloadMaxCache);
+	if(r->cache_count > HotReloadMaxCache && e->object != 0
+			&& e->object != hotreload_live_object(r, e->kind)) {
+		hotreload_delete_object(e->kind, e->object);
+	}
+	e->kind = kind;
+	e->hash = hash;
+	e->object = 0;
+	e->width = e->height = 0;
+	return e;
+}
+
+//Puts what's live in the cache under the hash of the files it came from,
+//so the first swap doesn't leak it and going back to it is free
+static
+void hotreload_cache_adopt(HotReloader* r, HotReloadKind kind, u64 hash)
+{
+	u32 live = hotreload_live_object(r, kind);
+	if(live == 0 || hash == 0) return;
+	if(hotreload_cache_holds(r, kind, live) || hotreload_cache_find(r, kind, hash) != NULL) return;
+	HotReloadCacheEntry* e = hotreload_cache_insert(r, kind, hash);
+	e->object = live;
+	if(kind == HotReload_Texture) {
+		e->width = r->renderer->groups[0].texture_width;
+		e->height = r->renderer->groups[0].texture_height;
+	}
+}
+
+//After a swap, the old object goes unless the cache still has it
+static
+void hotreload_release(HotReloader* r, HotReloadKind kind, u32 old)
+{
+	if(old != 0 && old != hotreload_live_object(r, kind) && !hotreload_cache_holds(r, kind, old)) {
+		hotreload_delete_object(kind, old);
+	}
+}
+
+static
+void hotreload_track(HotReloader* r, string path, HotReloadKind kind)
+{
+	if(path == NULL || r->file_count >= HotReloadMaxFiles) return;
+	HotReloadFile* file = r->files + r->file_count++;
+	file->path = path;
+	file->kind = kind;
+	file->dirty = false;
+
+	char dir[256];
+	string slash = strrchr(path, '/');
+	if(slash == NULL) {
+		snprintf(dir, 256, ".");
+	} else {
+		snprintf(dir, 256, "%.*s", (i32)(slash - path), path);
+	}
+	for(i32 i = 0; i < r->dir_count; ++i) {
+		if(strcmp(r->dirs[i], dir) == 0) return;
+	}
+	memcpy(r->dirs[r->dir_count], dir, 256);
+	if(platform_watcher_add(r->watcher, r->dirs[r->dir_count])) {
+		r->dir_count++;
+	}
+}
+
+void hotreload_init(HotReloader* r, SpriteRenderer* renderer, string vert_path, string frag_path, string texture_path)
+{
+	memset(r, 0, sizeof(HotReloader));
+	r->renderer = renderer;
+	r->vert_path = vert_path;
+	r->frag_path = frag_path;
+	r->texture_path = texture_path;
+	r->watcher = platform_watcher_create();
+	if(r->watcher == NULL) return;
+
+	hotreload_track(r, vert_path, HotReload_Shader);
+	hotreload_track(r, frag_path, HotReload_Shader);
+	hotreload_track(r, texture_path, HotReload_Texture);
+
+	r->shader_hash = hotreload_hash_file(vert_path, FNV64_Basis, NULL, NULL);
+	r->shader_hash = hotreload_hash_file(frag_path, r->shader_hash, NULL, NULL);
+	r->texture_hash = hotreload_hash_file(texture_path, FNV64_Basis, NULL, NULL);
+
+	//The texture may still be streaming in; it's adopted on its first reload
+	//if it isn't here yet
+	hotreload_cache_adopt(r, HotReload_Shader, r->shader_hash);
+	hotreload_cache_adopt(r, HotReload_Texture, r->texture_hash);
+}
+
+static
+void hotreload_on_change(string dir, string filename, void* userdata)
+{
+	HotReloader* r = userdata;
+	usize dir_len = strlen(dir);
+	for(i32 i = 0; i < r->file_count; ++i) {
+		HotReloadFile* file = r->files + i;
+		if(strncmp(file->path, dir, dir_len) != 0 || file->path[dir_len] != '/') continue;
+		if(filename == NULL || strcmp(file->path + dir_len + 1, filename) == 0) {
+			file->dirty = true;
+		}
+	}
+}
+
+static
+void hotreload_shaders(HotReloader* r)
+{
+	char* vert;
+	char* frag;
+	u64 hash = hotreload_hash_file(r->vert_path, FNV64_Basis, &vert, NULL);
+	hash = hotreload_hash_file(r->frag_path, hash, &frag, NULL);
+	if(vert == NULL || frag == NULL || hash == r->shader_hash) {
+		free(vert);
+		free(frag);
+		return;
+	}
+
+	hotreload_cache_adopt(r, HotReload_Shader, r->shader_hash);
+	HotReloadCacheEntry* e = hotreload_cache_find(r, HotReload_Shader, hash);
+	if(e == NULL) {
+		u32 program = sprite_renderer_compile_program(vert, frag);
+		if(program != 0) {
+			e = hotreload_cache_insert(r, HotReload_Shader, hash);
+			e->object = program;
+		}
+	}
+	free(vert);
+	free(frag);
+
+	if(e == NULL) {
+		log_error("Hot reload: %s or %s failed to build, keeping the old shaders", r->vert_path, r->frag_path);
+		return;
+	}
+	u32 old = r->renderer->shaders;
+	sprite_renderer_set_program(r->renderer, e->object);
+	hotreload_release(r, HotReload_Shader, old);
+	r->shader_hash = hash;
+	printf("Hot reload: shaders %016llx\n", (unsigned long long)hash);
+}
+
+static
+void hotreload_texture(HotReloader* r)
+{
+	char* data;
+	isize size;
+	u64 hash = hotreload_hash_file(r->texture_path, FNV64_Basis, &data, &size);
+	if(data == NULL || hash == r->texture_hash) {
+		free(data);
+		return;
+	}
+
+	hotreload_cache_adopt(r, HotReload_Texture, r->texture_hash);
+	HotReloadCacheEntry* e = hotreload_cache_find(r, HotReload_Texture, hash);
+	if(e == NULL) {
+		i32 w, h, n;
+		u8* pixels = stbi_load_from_memory((u8*)data, size, &w, &h, &n, STBI_rgb_alpha);
+		if(pixels != NULL) {
+			e = hotreload_cache_insert(r, HotReload_Texture, hash);
+			e->object = ogl_add_texture(pixels, w, h);
+			e->width = w;
+			e->height = h;
+			STBI_FREE(pixels);
+		}
+	}
+	free(data);
+
+	if(e == NULL) {
+		log_error("Hot reload: could not decode %s, keeping the old texture", r->texture_path);
+		return;
+	}
+	u32 old = r->renderer->groups[0].texture;
+	sprite_renderer_set_texture(r->renderer, e->object, e->width, e->height);
+	hotreload_release(r, HotReload_Texture, old);
+	r->texture_hash = hash;
+	printf("Hot reload: texture %016llx\n", (unsigned long long)hash);
+}
+
+//Main thread, once per frame
+void hotreload_poll(HotReloader* r)
+{
+	if(r->watcher == NULL) return;
+	platform_watcher_poll(r->watcher, hotreload_on_change, r);
+
+	i32 shaders = false, texture = false;
+	for(i32 i = 0; i < r->file_count; ++i) {
+		HotReloadFile* file = r->files + i;
+		if(!file->dirty) continue;
+		file->dirty = false;
+		if(file->kind == HotReload_Shader) shaders = true;
+		if(file->kind == HotReload_Texture) texture = true;
+	}
+
+	if(shaders) hotreload_shaders(r);
+	if(texture) hotreload_texture(r);
+}
+
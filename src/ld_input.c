@@ -0,0 +1,358 @@
+
+/* Input
+ *
+ * Keys and mouse buttons share one ButtonState scheme. SDL events are turned
+ * into InputEvents, which are the only thing that changes input state; that
+ * way a recorded stream of them plays back to exactly the same state.
+ *
+ * Anything that gets a Just* state this tick goes on a small dirty list, and
+ * only those are demoted at the end of the tick, so the per tick cost is the
+ * number of things that changed rather than every scancode. If the list ever
+ * overflows, the end of the tick falls back to sweeping everything.
+ *
+ * Events are stamped with the tick that will first see them, the frame they
+ * were polled in, and SDL's millisecond timestamp. Recording writes every SDL
+ * event out (non-input ones just by type, window events with their data), 
+ * behind a header with the RNG seed and tick rate, and finishes with an End
+ * event on the last tick. Replaying reads them back and applies each one at
+ * the start of its tick, ignoring live input.
+ */
+
+typedef enum ButtonState_
+{
+	Button_JustReleased = -1,
+	Button_Released,
+	Button_Pressed,
+	Button_JustPressed
+} ButtonState;
+
+//SDL_BUTTON_LEFT is 1, so index with the SDL value directly
+#define InputMouseButtons 8
+#define InputMaxDirty 64
+//Mouse buttons go on the dirty list after the scancodes
+#define InputDirtyMouse SDL_NUM_SCANCODES
+
+#define InputLogMagic 0x504E4957 //"WINP"
+//Bumped whenever the same seed stops giving the same room, too
+#define InputLogVersion 4
+
+typedef enum InputEventKind_
+{
+	InputEvent_Key,
+	InputEvent_MouseButton,
+	InputEvent_MouseMotion,
+	InputEvent_MouseWheel,
+	//Recorded for the log but don't change input state
+	InputEvent_Quit,
+	InputEvent_Window,
+	InputEvent_Other,
+	InputEvent_End
+} InputEventKind;
+
+//20 bytes; code is the SDL event type for Other and the window event for Window
+typedef struct InputEvent_
+{
+	u32 tick;
+	u32 frame;
+	u32 timestamp;
+	u8 kind;
+	u8 down;
+	u16 code;
+	i16 x;
+	i16 y;
+} InputEvent;
+
+typedef struct InputLogHeader_
+{
+	u32 magic;
+	u32 version;
+	u64 seed;
+	f32 tick_rate;
+	u32 reserved;
+} InputLogHeader;
+
+typedef struct InputState_
+{
+	i32 keys[SDL_NUM_SCANCODES];
+	u32 key_times[SDL_NUM_SCANCODES];
+	i32 mouse_buttons[InputMouseButtons];
+	u32 mouse_times[InputMouseButtons];
+	Vec2i mouse;
+	//Accumulated over the tick, cleared at the end of it
+	Vec2i mouse_delta;
+	i32 wheel;
+
+	u16 dirty[InputMaxDirty];
+	i32 dirty_count;
+	i32 dirty_overflow;
+
+	//The frame being run and the next tick to run
+	u32 frame;
+	u32 tick;
+
+	FILE* record;
+	FILE* replay;
+	InputEvent next_replay;
+	i32 has_next_replay;
+} InputState;
+
+void input_init(InputState* input)
+{
+	memset(input, 0, sizeof(InputState));
+}
+
+static inline
+void input_mark_dirty(InputState* input, u16 index)
+{
+	if(input->dirty_count < InputMaxDirty) {
+		input->dirty[input->dirty_count++] = index;
+	} else {
+		input->dirty_overflow = true;
+	}
+}
+
+static inline
+void input_set_button(InputState* input, i32* state, u32* time, u16 dirty_index, i32 down, u32 timestamp)
+{
+	*state = down ? Button_JustPressed : Button_JustReleased;
+	*time = timestamp;
+	input_mark_dirty(input, dirty_index);
+}
+
+void input_apply(InputState* input, InputEvent* event)
+{
+	if(input->record != NULL) {
+		fwrite(event, sizeof(InputEvent), 1, input->record);
+	}
+
+	switch(event->kind) {
+		case InputEvent_Key:
+			if(event->code >= SDL_NUM_SCANCODES) break;
+			input_set_button(input, input->keys + event->code, input->key_times + event->code,
+					event->code, event->down, event->timestamp);
+			break;
+		case InputEvent_MouseButton:
+			if(event->code >= InputMouseButtons) break;
+			input_set_button(input, input->mouse_buttons + event->code, input->mouse_times + event->code,
+					InputDirtyMouse + event->code, event->down, event->timestamp);
+			input->mouse = v2i(event->x, event->y);
+			break;
+		case InputEvent_MouseMotion:
+			input->mouse_delta.x += event->x - input->mouse.x;
+			input->mouse_delta.y += event->y - input->mouse.y;
+			input->mouse = v2i(event->x, event->y);
+			break;
+		case InputEvent_MouseWheel:
+			input->wheel += event->y;
+			break;
+		default:
+			break;
+	}
+}
+
+//tick is the next tick to run, the first one that will see events polled now
+void input_begin_frame(InputState* input, u32 frame, u32 tick)
+{
+	input->frame = frame;
+	input->tick = tick;
+}
+
+void input_handle_event(InputState* input, SDL_Event* sdl_event)
+{
+	if(input->replay != NULL) return;
+
+	InputEvent event;
+	memset(&event, 0, sizeof(InputEvent));
+	event.tick = input->tick;
+	event.frame = input->frame;
+	event.timestamp = sdl_event->common.timestamp;
+	switch(sdl_event->type) {
+		case SDL_KEYDOWN:
+		case SDL_KEYUP:
+			if(sdl_event->key.repeat) return;
+			event.kind = InputEvent_Key;
+			event.code = sdl_event->key.keysym.scancode;
+			event.down = sdl_event->type == SDL_KEYDOWN;
+			break;
+		case SDL_MOUSEBUTTONDOWN:
+		case SDL_MOUSEBUTTONUP:
+			event.kind = InputEvent_MouseButton;
+			event.code = sdl_event->button.button;
+			event.down = sdl_event->type == SDL_MOUSEBUTTONDOWN;
+			event.x = sdl_event->button.x;
+			event.y = sdl_event->button.y;
+			break;
+		case SDL_MOUSEMOTION:
+			event.kind = InputEvent_MouseMotion;
+			event.x = sdl_event->motion.x;
+			event.y = sdl_event->motion.y;
+			break;
+		case SDL_MOUSEWHEEL:
+			event.kind = InputEvent_MouseWheel;
+			event.x = sdl_event->wheel.x;
+			event.y = sdl_event->wheel.y;
+			break;
+		case SDL_QUIT:
+			event.kind = InputEvent_Quit;
+			break;
+		case SDL_WINDOWEVENT:
+			event.kind = InputEvent_Window;
+			event.code = sdl_event->window.event;
+			event.x = (i16)sdl_event->window.data1;
+			event.y = (i16)sdl_event->window.data2;
+			break;
+		default:
+			event.kind = InputEvent_Other;
+			event.code = (u16)sdl_event->type;
+			break;
+	}
+	input_apply(input, &event);
+}
+
+static
+void input_replay_read(InputState* input)
+{
+	input->has_next_replay = fread(&input->next_replay, sizeof(InputEvent), 1, input->replay) == 1;
+}
+
+//Applies recorded events for this tick, when replaying
+void input_begin_tick(InputState* input, u32 tick)
+{
+	input->tick = tick;
+	if(input->replay == NULL) return;
+	while(input->has_next_replay && input->next_replay.tick <= tick) {
+		if(input->next_replay.kind == InputEvent_End) {
+			input->has_next_replay = false;
+			break;
+		}
+		input_apply(input, &input->next_replay);
+		input_replay_read(input);
+	}
+}
+
+static inline
+void input_settle(i32* state)
+{
+	if(*state == Button_JustPressed) {
+		*state = Button_Pressed;
+	} else if(*state == Button_JustReleased) {
+		*state = Button_Released;
+	}
+}
+
+void input_end_tick(InputState* input)
+{
+	if(input->dirty_overflow) {
+		for(isize i = 0; i < SDL_NUM_SCANCODES; ++i) {
+			input_settle(input->keys + i);
+		}
+		for(isize i = 0; i < InputMouseButtons; ++i) {
+			input_settle(input->mouse_buttons + i);
+		}
+	} else {
+		for(i32 i = 0; i < input->dirty_count; ++i) {
+			u16 index = input->dirty[i];
+			if(index < InputDirtyMouse) {
+				input_settle(input->keys + index);
+			} else {
+				input_settle(input->mouse_buttons + (index - InputDirtyMouse));
+			}
+		}
+	}
+	input->dirty_count = 0;
+	input->dirty_overflow = false;
+	input->mouse_delta = v2i(0, 0);
+	input->wheel = 0;
+}
+
+i32 input_record_start(InputState* input, string filename, u64 seed, f32 tick_rate)
+{
+	input->record = fopen(filename, "wb");
+	if(input->record == NULL) {
+		log_error("Error: could not open %s to record input", filename);
+		return false;
+	}
+	InputLogHeader header;
+	memset(&header, 0, sizeof(InputLogHeader));
+	header.magic = InputLogMagic;
+	header.version = InputLogVersion;
+	header.seed = seed;
+	header.tick_rate = tick_rate;
+	fwrite(&header, sizeof(InputLogHeader), 1, input->record);
+	return true;
+}
+
+//header_out gets the seed and tick rate the session was recorded with
+i32 input_replay_start(InputState* input, string filename, InputLogHeader* header_out)
+{
+	input->replay = fopen(filename, "rb");
+	if(input->replay == NULL) {
+		log_error("Error: could not open input log %s", filename);
+		return false;
+	}
+	InputLogHeader header;
+	if(fread(&header, sizeof(InputLogHeader), 1, input->replay) != 1 ||
+			header.magic != InputLogMagic || header.version != InputLogVersion) {
+		log_error("Error: %s isn't an input log this build can read", filename);
+		fclose(input->replay);
+		input->replay = NULL;
+		return false;
+	}
+	input_replay_read(input);
+	if(header_out != NULL) *header_out = header;
+	return true;
+}
+
+//True once a replay has reached the end of the session
+i32 input_replay_finished(InputState* input)
+{
+	return input->replay != NULL && !input->has_next_replay;
+}
+
+void input_close(InputState* input)
+{
+	if(input->record != NULL) {
+		InputEvent end;
+		memset(&end, 0, sizeof(InputEvent));
+		end.kind = InputEvent_End;
+		end.tick = input->tick;
+		end.frame = input->frame;
+		end.timestamp = SDL_GetTicks();
+		fwrite(&end, sizeof(InputEvent), 1, input->record);
+		fclose(input->record);
+	}
+	if(input->replay != NULL) fclose(input->replay);
+	input->record = NULL;
+	input->replay = NULL;
+}
+
+static inline
+i32 input_key_down(InputState* input, SDL_Scancode key)
+{
+	return input->keys[key] >= Button_Pressed;
+}
+
+static inline
+i32 input_key_pressed(InputState* input, SDL_Scancode key)
+{
+	return input->keys[key] == Button_JustPressed;
+}
+
+static inline
+i32 input_key_released(InputState* input, SDL_Scancode key)
+{
+	return input->keys[key] == Button_JustReleased;
+}
+
+static inline
+i32 input_mouse_down(InputState* input, i32 button)
+{
+	return input->mouse_buttons[button] >= Button_Pressed;
+}
+
+static inline
+i32 input_mouse_pressed(InputState* input, i32 button)
+{
+	return input->mouse_buttons[button] == Button_JustPressed;
+}
+
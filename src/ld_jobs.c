@@ -0,0 +1,382 @@
+
+/* Jobs
+ *
+ * One worker thread per core besides the main thread, each of which owns a
+ * Chase-Lev work-stealing deque. A thread pushes and pops jobs at the bottom
+ * of its own deque, so nested work stays hot in its cache; when that runs
+ * dry it steals from the top of someone else's. Only the owner touches the
+ * bottom, so pushing and popping are a plain store and one atomic add, and
+ * a CAS on the top only happens when there's a race for the last job.
+ *
+ * The main thread is worker 0. Threads that aren't part of the system (the
+ * asset and audio threads) can't own a deque, so job_run on one of those
+ * just runs the job there and then; so does a push onto a full deque.
+ *
+ * Jobs are grouped with a JobCounter, which holds how many of them are still
+ * to finish. job_wait doesn't block: it runs other jobs until the counter is
+ * zero, so jobs can wait on the jobs they start. job_run_after holds a job
+ * back until a counter gets to zero, for simple dependencies.
+ *
+ * Idle workers spin for a bit, then sleep on a semaphore that pushes post to
+ * when anyone's sleeping.
+ */
+
+#define JobMaxThreads 32
+//Must be a power of two
+#define JobDequeSize 1024
+#define JobMaxAfter 16
+#define JobIdleSpins 256
+
+struct JobCounter_;
+
+//Single jobs get start = end = 0; job_parallel_for hands out ranges
+typedef void (*JobProc)(void* data, i32 start, i32 end);
+
+typedef struct Job_
+{
+	JobProc proc;
+	void* data;
+	i32 start, end;
+	struct JobCounter_* counter;
+} Job;
+
+typedef struct JobCounter_
+{
+	SDL_atomic_t pending;
+	//Jobs between taking themselves off pending and being done with the
+	//counter; it can be on the waiter's stack, so it isn't done till this is 0
+	SDL_atomic_t finishing;
+	//Jobs to push once pending gets to zero
+	SDL_SpinLock lock;
+	Job after[JobMaxAfter];
+	i32 after_count;
+} JobCounter;
+
+typedef struct JobWorker_
+{
+	SDL_atomic_t top;
+	SDL_atomic_t bottom;
+	Job* jobs;
+	struct JobSystem_* system;
+	SDL_Thread* thread;
+	u32 steal_seed;
+	i32 index;
+	//Keeps one worker's top and bottom off the next one's cache line
+	u8 padding[64];
+} JobWorker;
+
+typedef struct JobSystem_
+{
+	JobWorker workers[JobMaxThreads];
+	//Including the main thread
+	i32 thread_count;
+	SDL_atomic_t running;
+	SDL_atomic_t sleeping;
+	SDL_sem* wake;
+	//Which worker the current thread is; NULL if it isn't one
+	SDL_TLSID tls;
+} JobSystem;
+
+void job_counter_init(JobCounter* counter)
+{
+	memset(counter, 0, sizeof(JobCounter));
+}
+
+static inline
+i32 job_counter_done(JobCounter* counter)
+{
+	return SDL_AtomicGet(&counter->pending) <= 0 && SDL_AtomicGet(&counter->finishing) == 0;
+}
+
+static inline
+JobWorker* job_current_worker(JobSystem* system)
+{
+	return SDL_TLSGet(system->tls);
+}
+
+//top and bottom only ever go up and may wrap, so compare their difference
+static inline
+i32 job_deque_count(i32 bottom, i32 top)
+{
+	return (i32)((u32)bottom - (u32)top);
+}
+
+//Owner only
+static
+i32 job_deque_push(JobWorker* w, Job* job)
+{
+	i32 b = SDL_AtomicGet(&w->bottom);
+	i32 t = SDL_AtomicGet(&w->top);
+	if(job_deque_count(b, t) >= JobDequeSize) return false;
+	w->jobs[(u32)b & (JobDequeSize - 1)] = *job;
+	//A full barrier, so a thief that sees the new bottom sees the job too
+	SDL_AtomicSet(&w->bottom, b + 1);
+	return true;
+}
+
+//Owner only
+static
+i32 job_deque_pop(JobWorker* w, Job* out)
+{
+	//Taking the bottom slot has to be visible before top is read, or a
+	//thief and the owner could both take the last job
+	i32 b = SDL_AtomicAdd(&w->bottom, -1) - 1;
+	i32 t = SDL_AtomicGet(&w->top);
+	i32 count = job_deque_count(b, t);
+	if(count < 0) {
+		SDL_AtomicSet(&w->bottom, t);
+		return false;
+	}
+	*out = w->jobs[(u32)b & (JobDequeSize - 1)];
+	if(count > 0) return true;
+
+	//The last one; whoever moves top first gets it
+	i32 won = SDL_AtomicCAS(&w->top, t, t + 1);
+	SDL_AtomicSet(&w->bottom, t + 1);
+	return won;
+}
+
+//Any thread. Fails if the deque is empty or another thief got there first
+static
+i32 job_deque_steal(JobWorker* w, Job* out)
+{
+	i32 t = SDL_AtomicGet(&w->top);
+	i32 b = SDL_AtomicGet(&w->bottom);
+	if(job_deque_count(b, t) <= 0) return false;
+	//Copied before the CAS; if the CAS fails the copy may be torn, but then
+	//it's thrown away
+	*out = w->jobs[(u32)t & (JobDequeSize - 1)];
+	return SDL_AtomicCAS(&w->top, t, t + 1);
+}
+
+static void job_submit(JobSystem* system, Job* job);
+
+static
+void job_finish(JobSystem* system, JobCounter* counter)
+{
+	SDL_AtomicAdd(&counter->finishing, 1);
+	if(SDL_AtomicAdd(&counter->pending, -1) != 1) {
+		SDL_AtomicAdd(&counter->finishing, -1);
+		return;
+	}
+
+	Job after[JobMaxAfter];
+	SDL_AtomicLock(&counter->lock);
+	i32 count = counter->after_count;
+	memcpy(after, counter->after, sizeof(Job) * count);
+	counter->after_count = 0;
+	SDL_AtomicUnlock(&counter->lock);
+	SDL_AtomicAdd(&counter->finishing, -1);
+
+	for(i32 i = 0; i < count; ++i) {
+		job_submit(system, after + i);
+	}
+}
+
+static inline
+void job_execute(JobSystem* system, Job* job)
+{
+	job->proc(job->data, job->start, job->end);
+	if(job->counter != NULL) {
+		job_finish(system, job->counter);
+	}
+}
+
+static
+void job_submit(JobSystem* system, Job* job)
+{
+	JobWorker* w = job_current_worker(system);
+	if(w == NULL || system->thread_count <= 1 || !job_deque_push(w, job)) {
+		job_execute(system, job);
+		return;
+	}
+	if(SDL_AtomicGet(&system->sleeping) > 0) {
+		SDL_SemPost(system->wake);
+	}
+}
+
+//Own deque first, then steal, starting from a random worker so the thieves
+//spread out
+static
+i32 job_find(JobSystem* system, JobWorker* w, Job* out)
+{
+	if(w != NULL && job_deque_pop(w, out)) return true;
+
+	u32 seed = w != NULL ? w->steal_seed : (u32)SDL_GetPerformanceCounter();
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	if(w != NULL) w->steal_seed = seed;
+
+	i32 count = system->thread_count;
+	for(i32 i = 0; i < count; ++i) {
+		JobWorker* victim = system->workers + (seed + i) % count;
+		if(victim != w && job_deque_steal(victim, out)) return true;
+	}
+	return false;
+}
+
+//Runs one job if there's one to be had
+i32 job_help(JobSystem* system)
+{
+	Job job;
+	if(!job_find(system, job_current_worker(system), &job)) return false;
+	job_execute(system, &job);
+	return true;
+}
+
+static
+int job_worker_proc(void* userdata)
+{
+	JobWorker* w = userdata;
+	JobSystem* system = w->system;
+	SDL_TLSSet(system->tls, w, NULL);
+
+	Job job;
+	i32 idle = 0;
+	while(SDL_AtomicGet(&system->running)) {
+		if(job_find(system, w, &job)) {
+			job_execute(system, &job);
+			idle = 0;
+			continue;
+		}
+		if(++idle < JobIdleSpins) continue;
+
+		//Look once more after saying we're asleep; a push either sees
+		//sleeping and posts, or happened before this look and gets found
+		SDL_AtomicAdd(&system->sleeping, 1);
+		if(job_find(system, w, &job)) {
+			SDL_AtomicAdd(&system->sleeping, -1);
+			job_execute(system, &job);
+			idle = 0;
+			continue;
+		}
+		SDL_SemWait(system->wake);
+		SDL_AtomicAdd(&system->sleeping, -1);
+		idle = 0;
+	}
+	return 0;
+}
+
+//Call from the main thread. thread_count <= 0 uses every core
+void job_system_init(JobSystem* system, i32 thread_count, MemoryArena* arena)
+{
+	memset(system, 0, sizeof(JobSystem));
+	if(thread_count <= 0) {
+		thread_count = SDL_GetCPUCount();
+	}
+	if(thread_count < 1) thread_count = 1;
+	if(thread_count > JobMaxThreads) thread_count = JobMaxThreads;
+
+	system->thread_count = thread_count;
+	system->wake = SDL_CreateSemaphore(0);
+	system->tls = SDL_TLSCreate();
+	SDL_AtomicSet(&system->running, 1);
+
+	for(i32 i = 0; i < thread_count; ++i) {
+		JobWorker* w = system->workers + i;
+		w->jobs = arena_push(arena, sizeof(Job) * JobDequeSize);
+		w->system = system;
+		w->index = i;
+		w->steal_seed = 0x9E3779B9u * (i + 1);
+	}
+
+	SDL_TLSSet(system->tls, system->workers, NULL);
+	for(i32 i = 1; i < thread_count; ++i) {
+		system->workers[i].thread = SDL_CreateThread(job_worker_proc, "JobWorker", system->workers + i);
+	}
+}
+
+//Jobs still queued are dropped; wait on their counters first
+void job_system_shutdown(JobSystem* system)
+{
+	SDL_AtomicSet(&system->running, 0);
+	for(i32 i = 1; i < system->thread_count; ++i) {
+		SDL_SemPost(system->wake);
+	}
+	for(i32 i = 1; i < system->thread_count; ++i) {
+		SDL_WaitThread(system->workers[i].thread, NULL);
+	}
+	system->thread_count = 1;
+	SDL_DestroySemaphore(system->wake);
+}
+
+static
+void job_init(Job* job, JobProc proc, void* data, i32 start, i32 end, JobCounter* counter)
+{
+	job->proc = proc;
+	job->data = data;
+	job->start = start;
+	job->end = end;
+	job->counter = counter;
+	if(counter != NULL) {
+		SDL_AtomicAdd(&counter->pending, 1);
+	}
+}
+
+//counter can be NULL if nothing needs to know when it's done
+void job_run(JobSystem* system, JobProc proc, void* data, JobCounter* counter)
+{
+	Job job;
+	job_init(&job, proc, data, 0, 0, counter);
+	job_submit(system, &job);
+}
+
+//Runs once wait_for gets to zero, or now if it already has. counter counts
+//the job from now, not from when it's let go.
+void job_run_after(JobSystem* system, JobCounter* wait_for, JobProc proc, void* data, JobCounter* counter)
+{
+	Job job;
+	job_init(&job, proc, data, 0, 0, counter);
+
+	//job_finish takes the lock after pending hits zero, so under the lock
+	//either it's still coming and will see this job, or it's already been
+	SDL_AtomicLock(&wait_for->lock);
+	if(SDL_AtomicGet(&wait_for->pending) > 0 && wait_for->after_count < JobMaxAfter) {
+		wait_for->after[wait_for->after_count++] = job;
+		SDL_AtomicUnlock(&wait_for->lock);
+		return;
+	}
+	SDL_AtomicUnlock(&wait_for->lock);
+
+	//Out of room; wait here instead
+	while(!job_counter_done(wait_for)) {
+		if(!job_help(system)) SDL_Delay(0);
+	}
+	job_submit(system, &job);
+}
+
+//Runs other jobs until counter is done; fine to call from inside a job
+void job_wait(JobSystem* system, JobCounter* counter)
+{
+	while(!job_counter_done(counter)) {
+		if(!job_help(system)) {
+			SDL_Delay(0);
+		}
+	}
+}
+
+//Calls proc on [start, end) ranges of at most batch items covering
+//[0, count), spread across the workers, and returns once they're all done.
+//batch <= 0 picks about four ranges per thread.
+void job_parallel_for(JobSystem* system, i32 count, i32 batch, JobProc proc, void* data)
+{
+	if(count <= 0) return;
+	if(batch <= 0) {
+		batch = count / (system->thread_count * 4);
+	}
+	if(batch < 1) batch = 1;
+
+	JobCounter counter;
+	job_counter_init(&counter);
+	//The first range is left for this thread, so it has something to do
+	for(i32 start = batch; start < count; start += batch) {
+		i32 end = count - start > batch ? start + batch : count;
+		Job job;
+		job_init(&job, proc, data, start, end, &counter);
+		job_submit(system, &job);
+	}
+	proc(data, 0, batch < count ? batch : count);
+	job_wait(system, &counter);
+}
+
@@ -0,0 +1,137 @@
+
+#include <sys/mman.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+//munmap needs the size back, so allocations keep it in a header page in front
+//of the pointer we hand out.
+
+void* platform_allocate_memory(isize size, void* userdata)
+{
+	u8* data = mmap(userdata, size + PageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(data == MAP_FAILED) return NULL;
+	*(isize*)data = size + PageSize;
+	return data + PageSize;
+}
+
+void* platform_reserve_memory(isize size, void* userdata)
+{
+	u8* data = mmap(userdata, size + PageSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(data == MAP_FAILED) return NULL;
+	mprotect(data, PageSize, PROT_READ | PROT_WRITE);
+	*(isize*)data = size + PageSize;
+	return data + PageSize;
+}
+
+void platform_commit_memory(isize size, void* ptr)
+{
+	mprotect(ptr, size, PROT_READ | PROT_WRITE);
+}
+
+void platform_free_memory(void* ptr, void* userdata)
+{
+	u8* data = (u8*)ptr - PageSize;
+	munmap(data, *(isize*)data);
+}
+
+void platform_decommit_memory(void* ptr, void* userdata)
+{
+	madvise(ptr, *(isize*)userdata, MADV_DONTNEED);
+}
+
+void* platform_map_file(string name, isize* size_out)
+{
+	i32 fd = open(name, O_RDONLY);
+	if(fd == -1) {
+		return NULL;
+	}
+
+	struct stat info;
+	if(fstat(fd, &info) == -1 || info.st_size == 0) {
+		close(fd);
+		return NULL;
+	}
+
+	void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(data == MAP_FAILED) {
+		return NULL;
+	}
+
+	if(size_out != NULL) {
+		*size_out = info.st_size;
+	}
+	return data;
+}
+
+void platform_unmap_file(void* ptr, isize size)
+{
+	munmap(ptr, size);
+}
+
+#define PlatformMaxWatches 32
+
+struct PlatformWatcher_
+{
+	i32 fd;
+	i32 watches[PlatformMaxWatches];
+	string dirs[PlatformMaxWatches];
+	i32 count;
+};
+
+PlatformWatcher* platform_watcher_create()
+{
+	i32 fd = inotify_init1(IN_NONBLOCK);
+	if(fd == -1) {
+		log_error("Error: could not start inotify: %s", strerror(errno));
+		return NULL;
+	}
+	PlatformWatcher* watcher = calloc(1, sizeof(PlatformWatcher));
+	watcher->fd = fd;
+	return watcher;
+}
+
+i32 platform_watcher_add(PlatformWatcher* watcher, string dir)
+{
+	if(watcher->count >= PlatformMaxWatches) return false;
+	//Editors either write in place (CLOSE_WRITE) or write elsewhere and rename over (MOVED_TO)
+	i32 wd = inotify_add_watch(watcher->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+	if(wd == -1) {
+		log_error("Error: could not watch %s", dir);
+		return false;
+	}
+	watcher->watches[watcher->count] = wd;
+	watcher->dirs[watcher->count] = dir;
+	watcher->count++;
+	return true;
+}
+
+void platform_watcher_poll(PlatformWatcher* watcher, PlatformFileChangedProc proc, void* userdata)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	for(;;) {
+		isize len = read(watcher->fd, buf, sizeof(buf));
+		if(len <= 0) break;
+
+		for(char* p = buf; p < buf + len; ) {
+			struct inotify_event* event = (struct inotify_event*)p;
+			p += sizeof(struct inotify_event) + event->len;
+			if(event->len == 0) continue;
+			for(i32 i = 0; i < watcher->count; ++i) {
+				if(watcher->watches[i] == event->wd) {
+					proc(watcher->dirs[i], event->name, userdata);
+					break;
+				}
+			}
+		}
+	}
+}
+
+void platform_watcher_free(PlatformWatcher* watcher)
+{
+	close(watcher->fd);
+	free(watcher);
+}
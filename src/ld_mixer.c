@@ -0,0 +1,596 @@
+
+/* Block mixer
+ *
+ * Replaces sts_mixer's loop of "for every output frame, for every voice,
+ * switch on the format, convert, clamp". Here each active voice is handled a
+ * block at a time: its source frames are gathered and converted to float
+ * once (the format switch happens per block, not per sample), resampled, then
+ * gain/pan is applied and accumulated into the output four floats at a time.
+ * Only voices that are actually playing are visited, through a compact
+ * active list. The caller clamps once over the whole buffer at the end,
+ * after anything else (music) has been added in.
+ *
+ * Resampling (sample rate conversion and pitch) uses a 32.32 fixed point
+ * phase, so there's no drift on long samples. Each block, the span of source
+ * frames the kernel will touch is converted into a planar float window,
+ * zero padded past either end of the sample; the kernels then run over that
+ * window with no bounds checks or format branches. The kernel is picked per
+ * mixer, through a function pointer, not per sample.
+ *
+ * Voices belong to the audio thread. As with sts_mixer, only call these from
+ * the audio callback; the game thread goes through the audio commands in
+ * ld_audio.c instead.
+ */
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MIXER_SSE
+#include <xmmintrin.h>
+#endif
+
+#define MixerMaxVoices 128
+#define MixerBlockFrames 256
+//Source frames one block can read; a block shrinks if pitch * rate ratio is
+//high enough to need more than this
+#define MixerWindowFrames (MixerBlockFrames * 4 + 16)
+
+#define ResampleSincTaps 8
+#define ResampleSincPhases 256
+
+typedef enum SampleFormat_
+{
+	SampleFormat_S16,
+	SampleFormat_F32
+} SampleFormat;
+
+typedef struct MixerSample_
+{
+	void* data;
+	u32 frames;
+	u32 channels;
+	u32 sample_rate;
+	SampleFormat format;
+} MixerSample;
+
+typedef enum VoiceState_
+{
+	Voice_Stopped,
+	Voice_Playing
+} VoiceState;
+
+typedef enum ResampleKernel_
+{
+	Resample_Linear,
+	Resample_Cubic,
+	Resample_Sinc,
+	ResampleKernel_Count
+} ResampleKernel;
+
+typedef struct MixerVoice_
+{
+	MixerSample* sample;
+	VoiceState state;
+	//32.32 fixed point, in source frames
+	u64 position;
+	u64 step;
+	f32 gain;
+	f32 pan;
+	f32 pitch;
+
+	//Linear gain ramp; the voice stops at the end of it if fade_stop is set
+	u32 fade_frames;
+	f32 fade_delta;
+	f32 fade_target;
+	i32 fade_stop;
+} MixerVoice;
+
+//Writes count interleaved stereo frames to dst. wl/wr point at the window
+//frame that matches the integer part of the start position, phase is the
+//fractional part (32 bit) and step the 32.32 increment.
+typedef void (*ResampleProc)(f32* dst, const f32* wl, const f32* wr, u64 phase, u64 step, u32 count);
+
+typedef struct Mixer_
+{
+	u32 sample_rate;
+	f32 gain;
+
+	MixerVoice voices[MixerMaxVoices];
+	u16 active[MixerMaxVoices];
+	i32 active_count;
+
+	ResampleKernel kernel;
+
+	//Stereo float output for one voice's block, and the planar source window
+	f32* scratch;
+	f32* window_left;
+	f32* window_right;
+} Mixer;
+
+//Taps each kernel reads, and how many of those come before the current frame
+const i32 ResampleTaps[ResampleKernel_Count] = {2, 4, ResampleSincTaps};
+const i32 ResampleTapsBefore[ResampleKernel_Count] = {0, 1, ResampleSincTaps / 2 - 1};
+
+//Blackman windowed sinc, one row of taps per phase, each row normalized
+f32* resample_sinc_table;
+
+static
+f32* mixer_push_aligned(MemoryArena* arena, isize count)
+{
+	//+16 so it can be aligned for SSE by hand
+	u8* data = arena_push(arena, sizeof(f32) * count + 16);
+	return (f32*)mem_align((usize)data, 16);
+}
+
+static
+void resample_init_sinc_table(MemoryArena* arena)
+{
+	if(resample_sinc_table != NULL) return;
+	resample_sinc_table = mixer_push_aligned(arena, ResampleSincTaps * ResampleSincPhases);
+	const f64 pi = 3.14159265358979323846;
+	for(i32 p = 0; p < ResampleSincPhases; ++p) {
+		f32* row = resample_sinc_table + p * ResampleSincTaps;
+		f64 frac = (f64)p / ResampleSincPhases;
+		f64 sum = 0;
+		for(i32 t = 0; t < ResampleSincTaps; ++t) {
+			f64 x = (t - (ResampleSincTaps / 2 - 1)) - frac;
+			f64 sinc = x == 0 ? 1.0 : sin(pi * x) / (pi * x);
+			//window spans the taps, centred on the interpolation point
+			f64 w = (x + ResampleSincTaps / 2) / ResampleSincTaps;
+			f64 blackman = 0.42 - 0.5 * cos(2 * pi * w) + 0.08 * cos(4 * pi * w);
+			row[t] = (f32)(sinc * blackman);
+			sum += row[t];
+		}
+		for(i32 t = 0; t < ResampleSincTaps; ++t) {
+			row[t] = (f32)(row[t] / sum);
+		}
+	}
+}
+
+void mixer_init(Mixer* mixer, u32 sample_rate, MemoryArena* arena)
+{
+	memset(mixer, 0, sizeof(Mixer));
+	mixer->sample_rate = sample_rate;
+	mixer->gain = 1.0f;
+	mixer->kernel = Resample_Cubic;
+	mixer->scratch = mixer_push_aligned(arena, MixerBlockFrames * 2);
+	mixer->window_left = mixer_push_aligned(arena, MixerWindowFrames);
+	mixer->window_right = mixer_push_aligned(arena, MixerWindowFrames);
+	resample_init_sinc_table(arena);
+}
+
+static inline
+void mixer_voice_update_step(Mixer* mixer, MixerVoice* voice)
+{
+	f64 ratio = (f64)voice->sample->sample_rate / (f64)mixer->sample_rate * voice->pitch;
+	voice->step = (u64)(ratio * 4294967296.0);
+	if(voice->step == 0) voice->step = 1;
+}
+
+//Returns the voice index, or -1 if every voice is busy
+i32 mixer_play_sample(Mixer* mixer, MixerSample* sample, f32 gain, f32 pitch, f32 pan)
+{
+	for(i32 i = 0; i < MixerMaxVoices; ++i) {
+		MixerVoice* voice = mixer->voices + i;
+		if(voice->state != Voice_Stopped) continue;
+
+		voice->sample = sample;
+		voice->position = 0;
+		voice->gain = gain;
+		voice->pitch = pitch;
+		voice->pan = pan;
+		voice->fade_frames = 0;
+		mixer_voice_update_step(mixer, voice);
+		voice->state = Voice_Playing;
+		mixer->active[mixer->active_count++] = i;
+		return i;
+	}
+	return -1;
+}
+
+void mixer_stop_voice(Mixer* mixer, i32 index)
+{
+	if(index < 0 || index >= MixerMaxVoices) return;
+	if(mixer->voices[index].state == Voice_Stopped) return;
+	mixer->voices[index].state = Voice_Stopped;
+	for(i32 a = 0; a < mixer->active_count; ++a) {
+		if(mixer->active[a] == index) {
+			mixer->active[a] = mixer->active[--mixer->active_count];
+			break;
+		}
+	}
+}
+
+//Ramps gain to target over frames (at the mixer's rate); stop ends the voice
+//once it gets there, for fade outs
+void mixer_fade_voice(Mixer* mixer, i32 index, f32 target, u32 frames, i32 stop)
+{
+	if(index < 0 || index >= MixerMaxVoices) return;
+	MixerVoice* voice = mixer->voices + index;
+	if(frames == 0) frames = 1;
+	voice->fade_frames = frames;
+	voice->fade_delta = (target - voice->gain) / frames;
+	voice->fade_target = target;
+	voice->fade_stop = stop;
+}
+
+void mixer_stop_all(Mixer* mixer)
+{
+	for(i32 i = 0; i < mixer->active_count; ++i) {
+		mixer->voices[mixer->active[i]].state = Voice_Stopped;
+	}
+	mixer->active_count = 0;
+}
+
+//Converts source frames [start, start + count) into planar float, with zeros
+//for anything before or past the end of the sample. The format switch and
+//the bounds are handled once here, not per sample.
+static
+void mixer_fill_window(f32* wl, f32* wr, MixerSample* sample, i64 start, u32 count)
+{
+	i64 end = start + count;
+	i64 first = start < 0 ? 0 : start;
+	i64 last = end > sample->frames ? sample->frames : end;
+	u32 lead = (u32)(first - start);
+	if(last < first) last = first;
+	if(lead > count) lead = count;
+
+	for(u32 i = 0; i < lead; ++i) {
+		wl[i] = wr[i] = 0;
+	}
+	wl += lead;
+	wr += lead;
+
+	u32 n = (u32)(last - first);
+	u32 channels = sample->channels;
+	u32 right = channels > 1 ? 1 : 0;
+	if(sample->format == SampleFormat_F32) {
+		f32* src = (f32*)sample->data + first * channels;
+		for(u32 i = 0; i < n; ++i) {
+			wl[i] = src[i * channels];
+			wr[i] = src[i * channels + right];
+		}
+	} else {
+		i16* src = (i16*)sample->data + first * channels;
+		const f32 scale = 1.0f / 32768.0f;
+		for(u32 i = 0; i < n; ++i) {
+			wl[i] = src[i * channels] * scale;
+			wr[i] = src[i * channels + right] * scale;
+		}
+	}
+
+	for(u32 i = n; i < count - lead; ++i) {
+		wl[i] = wr[i] = 0;
+	}
+}
+
+#define ResampleFracScale (1.0f / 4294967296.0f)
+
+#ifdef MIXER_SSE
+
+static inline
+void resample_store4(f32* dst, __m128 l, __m128 r)
+{
+	_mm_storeu_ps(dst, _mm_unpacklo_ps(l, r));
+	_mm_storeu_ps(dst + 4, _mm_unpackhi_ps(l, r));
+}
+
+static inline
+__m128 resample_gather4(const f32* w, const i32* index, i32 offset)
+{
+	return _mm_setr_ps(w[index[0] + offset], w[index[1] + offset], 
+			w[index[2] + offset], w[index[3] + offset]);
+}
+
+//Positions for the next four output frames
+static inline
+__m128 resample_positions4(u64* phase, u64 step, i32* index)
+{
+	f32 frac[4];
+	for(i32 k = 0; k < 4; ++k) {
+		index[k] = (i32)(*phase >> 32);
+		frac[k] = (u32)*phase * ResampleFracScale;
+		*phase += step;
+	}
+	return _mm_loadu_ps(frac);
+}
+
+#endif
+
+static
+void resample_linear(f32* dst, const f32* wl, const f32* wr, u64 phase, u64 step, u32 count)
+{
+	u32 i = 0;
+#ifdef MIXER_SSE
+	for(; i + 4 <= count; i += 4) {
+		i32 index[4];
+		__m128 t = resample_positions4(&phase, step, index);
+		__m128 l0 = resample_gather4(wl, index, 0), l1 = resample_gather4(wl, index, 1);
+		__m128 r0 = resample_gather4(wr, index, 0), r1 = resample_gather4(wr, index, 1);
+		__m128 l = _mm_add_ps(l0, _mm_mul_ps(_mm_sub_ps(l1, l0), t));
+		__m128 r = _mm_add_ps(r0, _mm_mul_ps(_mm_sub_ps(r1, r0), t));
+		resample_store4(dst + i * 2, l, r);
+	}
+#endif
+	for(; i < count; ++i) {
+		i32 j = (i32)(phase >> 32);
+		f32 t = (u32)phase * ResampleFracScale;
+		dst[i * 2] = wl[j] + (wl[j + 1] - wl[j]) * t;
+		dst[i * 2 + 1] = wr[j] + (wr[j + 1] - wr[j]) * t;
+		phase += step;
+	}
+}
+
+//Catmull-Rom through the four frames around the position
+static
+void resample_cubic(f32* dst, const f32* wl, const f32* wr, u64 phase, u64 step, u32 count)
+{
+	u32 i = 0;
+#ifdef MIXER_SSE
+	__m128 half = _mm_set1_ps(0.5f);
+	__m128 two = _mm_set1_ps(2.0f);
+	__m128 three = _mm_set1_ps(3.0f);
+	__m128 four = _mm_set1_ps(4.0f);
+	__m128 five = _mm_set1_ps(5.0f);
+	for(; i + 4 <= count; i += 4) {
+		i32 index[4];
+		__m128 t = resample_positions4(&phase, step, index);
+		__m128 out[2];
+		for(i32 c = 0; c < 2; ++c) {
+			const f32* w = c == 0 ? wl : wr;
+			__m128 p0 = resample_gather4(w, index, -1);
+			__m128 p1 = resample_gather4(w, index, 0);
+			__m128 p2 = resample_gather4(w, index, 1);
+			__m128 p3 = resample_gather4(w, index, 2);
+			//0.5 * (2p1 + (p2 - p0)t + (2p0 - 5p1 + 4p2 - p3)t^2 + (3p1 - p0 - 3p2 + p3)t^3)
+			__m128 a = _mm_sub_ps(p2, p0);
+			__m128 b = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(two, p0), _mm_mul_ps(four, p2)),
+					_mm_add_ps(_mm_mul_ps(five, p1), p3));
+			__m128 d = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(three, _mm_sub_ps(p1, p2)), p0), p3);
+			__m128 v = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(d, t), b), t), a);
+			v = _mm_add_ps(_mm_mul_ps(v, t), _mm_mul_ps(two, p1));
+			out[c] = _mm_mul_ps(v, half);
+		}
+		resample_store4(dst + i * 2, out[0], out[1]);
+	}
+#endif
+	for(; i < count; ++i) {
+		i32 j = (i32)(phase >> 32);
+		f32 t = (u32)phase * ResampleFracScale;
+		for(i32 c = 0; c < 2; ++c) {
+			const f32* w = c == 0 ? wl : wr;
+			f32 p0 = w[j - 1], p1 = w[j], p2 = w[j + 1], p3 = w[j + 2];
+			f32 a = p2 - p0;
+			f32 b = 2 * p0 - 5 * p1 + 4 * p2 - p3;
+			f32 d = 3 * (p1 - p2) - p0 + p3;
+			dst[i * 2 + c] = 0.5f * (((d * t + b) * t + a) * t + 2 * p1);
+		}
+		phase += step;
+	}
+}
+
+static
+void resample_sinc(f32* dst, const f32* wl, const f32* wr, u64 phase, u64 step, u32 count)
+{
+	const i32 before = ResampleSincTaps / 2 - 1;
+	for(u32 i = 0; i < count; ++i) {
+		i32 j = (i32)(phase >> 32);
+		const f32* coef = resample_sinc_table + ((u32)phase >> 24) * ResampleSincTaps;
+		const f32* l = wl + j - before;
+		const f32* r = wr + j - before;
+#ifdef MIXER_SSE
+		__m128 c0 = _mm_load_ps(coef), c1 = _mm_load_ps(coef + 4);
+		__m128 sl = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(l), c0), _mm_mul_ps(_mm_loadu_ps(l + 4), c1));
+		__m128 sr = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(r), c0), _mm_mul_ps(_mm_loadu_ps(r + 4), c1));
+		//Sum both at once: {l0+l2, r0+r2, l1+l3, r1+r3} then fold the halves
+		__m128 s = _mm_add_ps(_mm_unpacklo_ps(sl, sr), _mm_unpackhi_ps(sl, sr));
+		s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+		_mm_storel_pi((__m64*)(dst + i * 2), s);
+#else
+		f32 sl = 0, sr = 0;
+		for(i32 t = 0; t < ResampleSincTaps; ++t) {
+			sl += l[t] * coef[t];
+			sr += r[t] * coef[t];
+		}
+		dst[i * 2] = sl;
+		dst[i * 2 + 1] = sr;
+#endif
+		phase += step;
+	}
+}
+
+const ResampleProc ResampleProcs[ResampleKernel_Count] = {
+	resample_linear,
+	resample_cubic,
+	resample_sinc
+};
+
+/* Streaming resampler
+ *
+ * Same kernels, for sources that arrive in chunks (music). Decoded frames
+ * are appended to a planar window; pulling output consumes it, keeping the
+ * few frames of history the kernel needs across chunk boundaries. The window
+ * starts with a run of silence so the first output frame lines up with the
+ * first source frame.
+ */
+typedef struct ResampleStream_
+{
+	ResampleProc resample;
+	i32 taps;
+	i32 before;
+	//32.32, relative to the start of the window
+	u64 position;
+	u64 step;
+
+	f32* window_left;
+	f32* window_right;
+	u32 frames;
+	u32 capacity;
+} ResampleStream;
+
+//window_left/right must hold capacity frames; capacity should be at least
+//the largest chunk pushed plus the kernel's taps
+void resample_stream_init(ResampleStream* rs, ResampleKernel kernel, u32 src_rate, u32 dst_rate, 
+		f32* window_left, f32* window_right, u32 capacity)
+{
+	rs->resample = ResampleProcs[kernel];
+	rs->taps = ResampleTaps[kernel];
+	rs->before = ResampleTapsBefore[kernel];
+	rs->step = (u64)((f64)src_rate / (f64)dst_rate * 4294967296.0);
+	rs->position = (u64)rs->before << 32;
+	rs->window_left = window_left;
+	rs->window_right = window_right;
+	rs->capacity = capacity;
+	rs->frames = rs->before;
+	for(i32 i = 0; i < rs->before; ++i) {
+		window_left[i] = window_right[i] = 0;
+	}
+}
+
+//Appends interleaved stereo frames; returns how many fit
+u32 resample_stream_push(ResampleStream* rs, const f32* frames, u32 count)
+{
+	u32 space = rs->capacity - rs->frames;
+	if(count > space) count = space;
+	f32* l = rs->window_left + rs->frames;
+	f32* r = rs->window_right + rs->frames;
+	for(u32 i = 0; i < count; ++i) {
+		l[i] = frames[i * 2];
+		r[i] = frames[i * 2 + 1];
+	}
+	rs->frames += count;
+	return count;
+}
+
+//Writes up to max interleaved stereo frames, as many as the pushed input allows
+u32 resample_stream_pull(ResampleStream* rs, f32* out, u32 max)
+{
+	//Last frame the kernel can be centred on with all its taps in the window
+	i64 last = (i64)rs->frames - (rs->taps - rs->before);
+	u64 limit = (u64)(last + 1) << 32;
+	if(last < 0 || rs->position >= limit) return 0;
+	u64 count = (limit - rs->position + rs->step - 1) / rs->step;
+	if(count > max) count = max;
+
+	u32 base = (u32)(rs->position >> 32);
+	rs->resample(out, rs->window_left + base, rs->window_right + base,
+			rs->position & 0xFFFFFFFF, rs->step, (u32)count);
+	rs->position += count * rs->step;
+
+	//Drop what the kernel won't look at again
+	u32 keep_from = (u32)(rs->position >> 32) - rs->before;
+	if(keep_from > rs->frames) keep_from = rs->frames;
+	rs->frames -= keep_from;
+	memmove(rs->window_left, rs->window_left + keep_from, sizeof(f32) * rs->frames);
+	memmove(rs->window_right, rs->window_right + keep_from, sizeof(f32) * rs->frames);
+	rs->position -= (u64)keep_from << 32;
+	return (u32)count;
+}
+
+//out += src * {left, right}, count stereo frames, with left and right moving
+//by dleft and dright every frame (zero unless the voice is fading)
+static
+void mixer_accumulate(f32* out, const f32* src, u32 count, f32 left, f32 right, f32 dleft, f32 dright)
+{
+	u32 i = 0;
+#ifdef MIXER_SSE
+	__m128 g = _mm_setr_ps(left, right, left + dleft, right + dright);
+	__m128 dg = _mm_setr_ps(dleft * 2, dright * 2, dleft * 2, dright * 2);
+	for(; i + 2 <= count; i += 2) {
+		__m128 s = _mm_load_ps(src + i * 2);
+		__m128 o = _mm_loadu_ps(out + i * 2);
+		_mm_storeu_ps(out + i * 2, _mm_add_ps(o, _mm_mul_ps(s, g)));
+		g = _mm_add_ps(g, dg);
+	}
+#endif
+	for(; i < count; ++i) {
+		out[i * 2] += src[i * 2] * (left + dleft * i);
+		out[i * 2 + 1] += src[i * 2 + 1] * (right + dright * i);
+	}
+}
+
+//Clamps count stereo frames to [-1, 1], applying gain on the way
+void mixer_clamp(f32* out, u32 count, f32 gain)
+{
+	u32 i = 0;
+	count *= 2;
+#ifdef MIXER_SSE
+	__m128 g = _mm_set1_ps(gain);
+	__m128 lo = _mm_set1_ps(-1.0f);
+	__m128 hi = _mm_set1_ps(1.0f);
+	for(; i + 4 <= count; i += 4) {
+		__m128 o = _mm_mul_ps(_mm_loadu_ps(out + i), g);
+		_mm_storeu_ps(out + i, _mm_min_ps(_mm_max_ps(o, lo), hi));
+	}
+#endif
+	for(; i < count; ++i) {
+		f32 o = out[i] * gain;
+		out[i] = o < -1.0f ? -1.0f : (o > 1.0f ? 1.0f : o);
+	}
+}
+
+//Adds every active voice into out (count stereo frames). Doesn't clear or
+//clamp out; call mixer_clamp once everything has been mixed in.
+void mixer_mix_voices(Mixer* mixer, f32* out, u32 count)
+{
+	ResampleProc resample = ResampleProcs[mixer->kernel];
+	i32 taps = ResampleTaps[mixer->kernel];
+	i32 before = ResampleTapsBefore[mixer->kernel];
+	for(i32 a = 0; a < mixer->active_count; ) {
+		MixerVoice* voice = mixer->voices + mixer->active[a];
+		MixerSample* sample = voice->sample;
+
+		f32 pan_left = voice->pan > 0 ? 1.0f - voice->pan : 1.0f;
+		f32 pan_right = voice->pan < 0 ? 1.0f + voice->pan : 1.0f;
+
+		for(u32 done = 0; done < count && voice->state == Voice_Playing; ) {
+			u32 block = count - done;
+			if(block > MixerBlockFrames) block = MixerBlockFrames;
+
+			//Don't read more source than the window holds
+			u64 max_block = ((u64)(MixerWindowFrames - taps) << 32) / voice->step;
+			if(block > max_block) block = max_block < 1 ? 1 : (u32)max_block;
+			//Fades end on a block boundary so the ramp lands exactly
+			if(voice->fade_frames > 0 && block > voice->fade_frames) block = voice->fade_frames;
+
+			//Output frames left before the integer position passes the end
+			u64 end = (u64)sample->frames << 32;
+			u64 available = voice->position >= end ? 0 : 
+				(end - voice->position + voice->step - 1) / voice->step;
+			if(available <= block) {
+				block = (u32)available;
+				voice->state = Voice_Stopped;
+			}
+			if(block == 0) break;
+
+			i64 first = (i64)(voice->position >> 32);
+			u64 last_phase = (voice->position & 0xFFFFFFFF) + (block - 1) * voice->step;
+			u32 span = (u32)(last_phase >> 32) + taps;
+			mixer_fill_window(mixer->window_left, mixer->window_right, sample, first - before, span);
+
+			resample(mixer->scratch, mixer->window_left + before, mixer->window_right + before,
+					voice->position & 0xFFFFFFFF, voice->step, block);
+			f32 delta = 0;
+			i32 fading = voice->fade_frames > 0;
+			if(fading) {
+				delta = voice->fade_delta;
+				voice->fade_frames -= block;
+			}
+			mixer_accumulate(out + done * 2, mixer->scratch, block, 
+					voice->gain * pan_left, voice->gain * pan_right, 
+					delta * pan_left, delta * pan_right);
+			voice->gain += delta * block;
+			if(fading && voice->fade_frames == 0) {
+				voice->gain = voice->fade_target;
+				if(voice->fade_stop) voice->state = Voice_Stopped;
+			}
+			voice->position += block * voice->step;
+			done += block;
+		}
+
+		if(voice->state == Voice_Stopped) {
+			mixer->active[a] = mixer->active[--mixer->active_count];
+		} else {
+			a++;
+		}
+	}
+}
+
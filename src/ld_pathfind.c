@@ -0,0 +1,361 @@
+
+/* Pathfinding
+ *
+ * On a grid of cells, moving up, down, left or right. Every cell has a cost
+ * to step into, or PathBlocked (anything negative) if it can't be. A path
+ * starts from a cell, costing nothing, or from just off the edge of the grid,
+ * in which case its first step is into one of the cells next to that.
+ *
+ * path_bfs finds the fewest steps, path_astar the cheapest way to one cell
+ * and path_dijkstra the cheapest way to all of them, with how many cheapest
+ * ways there are to each (that count is only right when no cell costs 0).
+ * Afterwards path_extract walks back from a cell to get the path itself.
+ *
+ * A PathFinder holds the scratch for all of that, pushed on an arena once:
+ * a visited bitset, a queue for the BFS and a binary heap open list that
+ * cells are just pushed onto again when they get cheaper, with stale entries
+ * skipped as they come off. Each cell is only improved by its four
+ * neighbours, so the heap never needs more than four entries a cell. One
+ * PathFinder per thread.
+ */
+
+#define PathBlocked -1
+
+typedef struct PathGrid_
+{
+	i32 width, height;
+	i32* costs;
+	//Cheapest cell that isn't blocked, for the A* heuristic
+	i32 min_cost;
+} PathGrid;
+
+typedef struct PathHeapEntry_
+{
+	i32 priority;
+	i32 cell;
+} PathHeapEntry;
+
+typedef struct PathFinder_
+{
+	i32 max_cells;
+	//Per cell, from the last search; cost and steps are -1 where it didn't get
+	i32* cost;
+	i32* steps;
+	//The cell before on the way there, -1 for the first cell of the path
+	i32* from;
+	u32* ways;
+	u64* visited;
+	i32* queue;
+	PathHeapEntry* heap;
+	i32 heap_count;
+} PathFinder;
+
+void path_grid_init(PathGrid* grid, i32 width, i32 height, i32* costs)
+{
+	grid->width = width;
+	grid->height = height;
+	grid->costs = costs;
+	grid->min_cost = 0;
+	i32 first = true;
+	for(i32 i = 0; i < width * height; ++i) {
+		if(costs[i] < 0) continue;
+		if(first || costs[i] < grid->min_cost) grid->min_cost = costs[i];
+		first = false;
+	}
+}
+
+//What pathfinder_init pushes for that many cells, near enough
+isize pathfinder_size(i32 max_cells)
+{
+	return (sizeof(i32) * 5 + sizeof(PathHeapEntry) * 4) * (isize)max_cells
+		+ sizeof(u64) * ((max_cells + 63) / 64) + sizeof(PathHeapEntry) * 4 + 64;
+}
+
+//Returns false if the arena's too small
+i32 pathfinder_init(PathFinder* pf, MemoryArena* arena, i32 max_cells)
+{
+	memset(pf, 0, sizeof(PathFinder));
+	pf->max_cells = max_cells;
+	pf->cost = arena_push(arena, sizeof(i32) * max_cells);
+	pf->steps = arena_push(arena, sizeof(i32) * max_cells);
+	pf->from = arena_push(arena, sizeof(i32) * max_cells);
+	pf->ways = arena_push(arena, sizeof(u32) * max_cells);
+	pf->visited = arena_push(arena, sizeof(u64) * ((max_cells + 63) / 64));
+	pf->queue = arena_push(arena, sizeof(i32) * max_cells);
+	pf->heap = arena_push(arena, sizeof(PathHeapEntry) * (max_cells * 4 + 4));
+	return pf->heap != NULL;
+}
+
+static inline
+i32 path_in_grid(PathGrid* grid, i32 x, i32 y)
+{
+	return x >= 0 && y >= 0 && x < grid->width && y < grid->height;
+}
+
+static inline
+i32 path_open(PathGrid* grid, i32 x, i32 y)
+{
+	return path_in_grid(grid, x, y) && grid->costs[y * grid->width + x] >= 0;
+}
+
+static inline
+i32 path_visited(PathFinder* pf, i32 cell)
+{
+	return (pf->visited[cell >> 6] >> (cell & 63)) & 1;
+}
+
+static inline
+void path_visit(PathFinder* pf, i32 cell)
+{
+	pf->visited[cell >> 6] |= (u64)1 << (cell & 63);
+}
+
+static const i32 path_dx[4] = {1, -1, 0, 0};
+static const i32 path_dy[4] = {0, 0, 1, -1};
+
+static inline
+i32 path_heap_less(PathHeapEntry* a, PathHeapEntry* b)
+{
+	return a->priority < b->priority || (a->priority == b->priority && a->cell < b->cell);
+}
+
+static
+void path_heap_push(PathFinder* pf, i32 priority, i32 cell)
+{
+	PathHeapEntry* heap = pf->heap;
+	PathHeapEntry e = {priority, cell};
+	i32 i = pf->heap_count++;
+	while(i > 0) {
+		i32 parent = (i - 1) / 2;
+		if(!path_heap_less(&e, heap + parent)) break;
+		heap[i] = heap[parent];
+		i = parent;
+	}
+	heap[i] = e;
+}
+
+static
+PathHeapEntry path_heap_pop(PathFinder* pf)
+{
+	PathHeapEntry* heap = pf->heap;
+	PathHeapEntry top = heap[0];
+	PathHeapEntry e = heap[--pf->heap_count];
+	i32 count = pf->heap_count;
+	i32 i = 0;
+	for(;;) {
+		i32 child = i * 2 + 1;
+		if(child >= count) break;
+		if(child + 1 < count && path_heap_less(heap + child + 1, heap + child)) child++;
+		if(!path_heap_less(heap + child, &e)) break;
+		heap[i] = heap[child];
+		i = child;
+	}
+	if(count > 0) heap[i] = e;
+	return top;
+}
+
+//Clears the last search and finds the first cells of the path, with what
+//they cost to get to; returns how many went in first, or -1 if the grid is
+//too big for pf, which leaves the last search's results alone
+static
+i32 path_begin(PathFinder* pf, PathGrid* grid, Vec2i start, i32* first)
+{
+	i32 cell_count = grid->width * grid->height;
+	if(cell_count > pf->max_cells) {
+		log_error("Error: a %dx%d grid is too big for this PathFinder", grid->width, grid->height);
+		return -1;
+	}
+	for(i32 i = 0; i < cell_count; ++i) {
+		pf->cost[i] = -1;
+		pf->steps[i] = -1;
+		pf->from[i] = -1;
+		pf->ways[i] = 0;
+	}
+	memset(pf->visited, 0, sizeof(u64) * ((cell_count + 63) / 64));
+	pf->heap_count = 0;
+
+	if(path_in_grid(grid, start.x, start.y)) {
+		i32 cell = start.y * grid->width + start.x;
+		pf->cost[cell] = 0;
+		pf->steps[cell] = 0;
+		pf->ways[cell] = 1;
+		first[0] = cell;
+		return 1;
+	}
+
+	i32 count = 0;
+	for(i32 d = 0; d < 4; ++d) {
+		i32 x = start.x + path_dx[d], y = start.y + path_dy[d];
+		if(!path_open(grid, x, y)) continue;
+		i32 cell = y * grid->width + x;
+		pf->cost[cell] = grid->costs[cell];
+		pf->steps[cell] = 1;
+		pf->ways[cell] = 1;
+		first[count++] = cell;
+	}
+	return count;
+}
+
+//Fewest steps from start to goal, ignoring cost, or -1 if it can't be reached
+i32 path_bfs(PathFinder* pf, PathGrid* grid, Vec2i start, Vec2i goal)
+{
+	i32 first[4];
+	i32 first_count = path_begin(pf, grid, start, first);
+	if(first_count == -1 || !path_in_grid(grid, goal.x, goal.y)) return -1;
+	i32 goal_cell = goal.y * grid->width + goal.x;
+
+	i32 head = 0, tail = 0;
+	for(i32 i = 0; i < first_count; ++i) {
+		path_visit(pf, first[i]);
+		pf->queue[tail++] = first[i];
+	}
+	while(head < tail) {
+		i32 cell = pf->queue[head++];
+		if(cell == goal_cell) return pf->steps[cell];
+		i32 cx = cell % grid->width, cy = cell / grid->width;
+		for(i32 d = 0; d < 4; ++d) {
+			i32 x = cx + path_dx[d], y = cy + path_dy[d];
+			if(!path_open(grid, x, y)) continue;
+			i32 next = y * grid->width + x;
+			if(path_visited(pf, next)) continue;
+			path_visit(pf, next);
+			pf->steps[next] = pf->steps[cell] + 1;
+			pf->cost[next] = pf->cost[cell] + grid->costs[next];
+			pf->from[next] = cell;
+			pf->queue[tail++] = next;
+		}
+	}
+	return -1;
+}
+
+//Dijkstra when goal is NULL, A* toward it otherwise
+static
+i32 path_search(PathFinder* pf, PathGrid* grid, Vec2i start, Vec2i* goal)
+{
+	i32 first[4];
+	i32 first_count = path_begin(pf, grid, start, first);
+	if(first_count == -1) return -1;
+	i32 goal_cell = -1;
+	if(goal != NULL) {
+		if(!path_in_grid(grid, goal->x, goal->y)) return -1;
+		goal_cell = goal->y * grid->width + goal->x;
+	}
+
+	for(i32 i = 0; i < first_count; ++i) {
+		i32 h = 0;
+		if(goal != NULL) {
+			i32 x = first[i] % grid->width, y = first[i] / grid->width;
+			h = (abs(goal->x - x) + abs(goal->y - y)) * grid->min_cost;
+		}
+		path_heap_push(pf, pf->cost[first[i]] + h, first[i]);
+	}
+
+	while(pf->heap_count > 0) {
+		i32 cell = path_heap_pop(pf).cell;
+		if(path_visited(pf, cell)) continue;
+		path_visit(pf, cell);
+		if(cell == goal_cell) return pf->cost[cell];
+
+		i32 cx = cell % grid->width, cy = cell / grid->width;
+		for(i32 d = 0; d < 4; ++d) {
+			i32 x = cx + path_dx[d], y = cy + path_dy[d];
+			if(!path_open(grid, x, y)) continue;
+			i32 next = y * grid->width + x;
+			if(path_visited(pf, next)) continue;
+
+			i32 cost = pf->cost[cell] + grid->costs[next];
+			if(pf->cost[next] != -1 && cost > pf->cost[next]) continue;
+			if(cost == pf->cost[next]) {
+				u32 ways = pf->ways[next] + pf->ways[cell];
+				pf->ways[next] = ways < pf->ways[next] ? 0xFFFFFFFFu : ways;
+				continue;
+			}
+			pf->cost[next] = cost;
+			pf->steps[next] = pf->steps[cell] + 1;
+			pf->from[next] = cell;
+			pf->ways[next] = pf->ways[cell];
+			i32 h = goal != NULL ? (abs(goal->x - x) + abs(goal->y - y)) * grid->min_cost : 0;
+			path_heap_push(pf, cost + h, next);
+		}
+	}
+	return -1;
+}
+
+//Cheapest cost from start to every cell, into pf->cost, steps, from and ways.
+//False if the grid is too big for pf, and then there's nothing there.
+i32 path_dijkstra(PathFinder* pf, PathGrid* grid, Vec2i start)
+{
+	if(grid->width * grid->height > pf->max_cells) {
+		log_error("Error: a %dx%d grid is too big for this PathFinder", grid->width, grid->height);
+		return false;
+	}
+	path_search(pf, grid, start, NULL);
+	return true;
+}
+
+//Cheapest cost from start to goal, or -1 if it can't be reached
+i32 path_astar(PathFinder* pf, PathGrid* grid, Vec2i start, Vec2i goal)
+{
+	return path_search(pf, grid, start, &goal);
+}
+
+//The last search's path to goal, first step first, not counting an off grid
+//start. Returns its length, which can be more than max; only max are written.
+isize path_extract(PathFinder* pf, PathGrid* grid, Vec2i goal, Vec2i* out, isize max)
+{
+	//Can't have been searched
+	if(grid->width * grid->height > pf->max_cells) return 0;
+	if(!path_in_grid(grid, goal.x, goal.y)) return 0;
+	i32 cell = goal.y * grid->width + goal.x;
+	if(pf->steps[cell] < 0) return 0;
+
+	isize length = 0;
+	for(i32 c = cell; c != -1; c = pf->from[c]) {
+		length++;
+	}
+	isize i = length;
+	for(i32 c = cell; c != -1; c = pf->from[c]) {
+		--i;
+		if(i < max) out[i] = v2i(c % grid->width, c / grid->width);
+	}
+	return length;
+}
+
+//Whether a path can go from one cell (or off the edge) to the next
+i32 path_step_valid(PathGrid* grid, Vec2i from, Vec2i to)
+{
+	i32 dx = abs(from.x - to.x);
+	i32 dy = abs(from.y - to.y);
+	return dx + dy == 1 && path_open(grid, to.x, to.y);
+}
+
+//Checks a whole path from start, adding up its cost into cost_out. Returns
+//how many steps of it are good; all of them means it's valid.
+isize path_validate(PathGrid* grid, Vec2i start, Vec2i* path, isize count, i32* cost_out)
+{
+	i32 cost = 0;
+	isize i = 0;
+	Vec2i at = start;
+	for(; i < count; ++i) {
+		if(!path_step_valid(grid, at, path[i])) break;
+		cost += grid->costs[path[i].y * grid->width + path[i].x];
+		at = path[i];
+	}
+	if(cost_out != NULL) *cost_out = cost;
+	return i;
+}
+
+//The next step along a cheapest way from one cell to goal; false if there
+//isn't a way, or from is already there
+i32 path_hint(PathFinder* pf, PathGrid* grid, Vec2i from, Vec2i goal, Vec2i* next)
+{
+	if(path_astar(pf, grid, from, goal) == -1) return false;
+	Vec2i steps[2];
+	isize length = path_extract(pf, grid, goal, steps, 2);
+	//A start on the grid is the first cell of its own path
+	isize index = path_in_grid(grid, from.x, from.y) ? 1 : 0;
+	if(length <= index) return false;
+	*next = steps[index];
+	return true;
+}
+
@@ -86,6 +86,23 @@ void platform_commit_memory(isize size, void* ptr);
 void platform_free_memory(void* ptr, void* userdata);
 void platform_decommit_memory(void* ptr, void* userdata);
 
+//Read-only file mappings; CreateFileMapping/MapViewOfFile on Win32, mmap on linux
+//Returns NULL if the file doesn't exist or is empty
+void* platform_map_file(string name, isize* size_out);
+void platform_unmap_file(void* ptr, isize size);
+
+//Directory change notifications, used for hot reloading in debug builds
+//inotify on linux; FindFirstChangeNotification on Win32, which can't say 
+//which file changed, so there filename is NULL and everything in dir 
+//should be treated as possibly changed
+typedef struct PlatformWatcher_ PlatformWatcher;
+typedef void (*PlatformFileChangedProc)(string dir, string filename, void* userdata);
+
+PlatformWatcher* platform_watcher_create();
+i32 platform_watcher_add(PlatformWatcher* watcher, string dir);
+void platform_watcher_poll(PlatformWatcher* watcher, PlatformFileChangedProc proc, void* userdata);
+void platform_watcher_free(PlatformWatcher* watcher);
+
 char* platform_read_file(string name, isize* size_out, Allocator alloc)
 {
 	char* str = NULL;
@@ -0,0 +1,129 @@
+
+/* Frame profiler
+ *
+ * A fixed set of zones, timed with the performance counter and stored per
+ * frame, so percentiles can be worked out at the end rather than just
+ * averages. Only allocated for --bench; every call takes a NULL profiler and
+ * does nothing with it, so the game loop can leave the calls in.
+ */
+
+typedef enum ProfileZone_
+{
+	Zone_Events,
+	Zone_Streaming,
+	Zone_Update,
+	Zone_Draw,
+	Zone_Present,
+	ProfileZone_Count
+} ProfileZone;
+
+const string ProfileZoneNames[ProfileZone_Count] = {
+	"events",
+	"streaming",
+	"update",
+	"draw",
+	"present"
+};
+
+typedef struct Profiler_
+{
+	u64 frequency;
+	i32 frame_capacity;
+	i32 frame;
+
+	u64 frame_start;
+	u64 zone_start[ProfileZone_Count];
+	//frame_capacity rows of ProfileZone_Count
+	u64* zone_times;
+	u64* frame_times;
+} Profiler;
+
+Profiler* profiler_create(MemoryArena* arena, i32 frames)
+{
+	Profiler* p = arena_push(arena, sizeof(Profiler));
+	memset(p, 0, sizeof(Profiler));
+	p->frequency = SDL_GetPerformanceFrequency();
+	p->frame_capacity = frames;
+	p->zone_times = arena_push(arena, sizeof(u64) * frames * ProfileZone_Count);
+	p->frame_times = arena_push(arena, sizeof(u64) * frames);
+	memset(p->zone_times, 0, sizeof(u64) * frames * ProfileZone_Count);
+	return p;
+}
+
+void profile_frame_begin(Profiler* p)
+{
+	if(p == NULL) return;
+	p->frame_start = SDL_GetPerformanceCounter();
+}
+
+void profile_frame_end(Profiler* p)
+{
+	if(p == NULL || p->frame >= p->frame_capacity) return;
+	p->frame_times[p->frame] = SDL_GetPerformanceCounter() - p->frame_start;
+	p->frame++;
+}
+
+static inline
+void profile_begin(Profiler* p, ProfileZone zone)
+{
+	if(p == NULL) return;
+	p->zone_start[zone] = SDL_GetPerformanceCounter();
+}
+
+//A zone can be entered more than once a frame (update, for one); the times add up
+static inline
+void profile_end(Profiler* p, ProfileZone zone)
+{
+	if(p == NULL || p->frame >= p->frame_capacity) return;
+	p->zone_times[p->frame * ProfileZone_Count + zone] += SDL_GetPerformanceCounter() - p->zone_start[zone];
+}
+
+i32 profiler_done(Profiler* p)
+{
+	return p != NULL && p->frame >= p->frame_capacity;
+}
+
+#define ProfileKey(x) (x)
+GenerateRadixSortForType(profile_sort_u64, u64, u64, ProfileKey)
+
+//sorted must be sorted; p is 0 to 100
+static
+f64 profile_percentile_ms(Profiler* prof, u64* sorted, i32 count, f64 p)
+{
+	if(count == 0) return 0;
+	i32 index = (i32)(p / 100.0 * (count - 1) + 0.5);
+	return sorted[index] * 1000.0 / prof->frequency;
+}
+
+void profiler_report(Profiler* p, f64 total_seconds)
+{
+	i32 count = p->frame;
+	if(count == 0) return;
+	u64* sorted = malloc(sizeof(u64) * count * 2);
+	u64* scratch = sorted + count;
+
+	memcpy(sorted, p->frame_times, sizeof(u64) * count);
+	profile_sort_u64(sorted, scratch, count);
+	printf("Bench: %d frames in %.3fs, %.1f fps\n", count, total_seconds, count / total_seconds);
+	printf("Frame ms: p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+			profile_percentile_ms(p, sorted, count, 50),
+			profile_percentile_ms(p, sorted, count, 90),
+			profile_percentile_ms(p, sorted, count, 99),
+			profile_percentile_ms(p, sorted, count, 100));
+
+	printf("%-10s %10s %10s %10s\n", "zone", "mean ms", "p50 ms", "p99 ms");
+	for(i32 z = 0; z < ProfileZone_Count; ++z) {
+		u64 total = 0;
+		for(i32 i = 0; i < count; ++i) {
+			sorted[i] = p->zone_times[i * ProfileZone_Count + z];
+			total += sorted[i];
+		}
+		profile_sort_u64(sorted, scratch, count);
+		printf("%-10s %10.3f %10.3f %10.3f\n", ProfileZoneNames[z],
+				total * 1000.0 / p->frequency / count,
+				profile_percentile_ms(p, sorted, count, 50),
+				profile_percentile_ms(p, sorted, count, 99));
+	}
+	free(sorted);
+}
+
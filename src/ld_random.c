@@ -42,17 +42,65 @@ void randomstate_init(RandomState* r, u64 seed)
 	rand_xoroshift(r);
 }
 
+//Equivalent to 2^64 calls to rand_xoroshift; states jumped from the same
+//seed give streams that won't overlap for anything we'd ever draw, so each
+//thread or job can have its own and still be deterministic
+void rand_jump(RandomState* r)
+{
+	static const u64 jump[] = {UINT64_C(0xBEAC0467EBA5FACB), UINT64_C(0xD86B048B86AA9922)};
+	u64 x = 0, y = 0;
+	for(isize i = 0; i < 2; ++i) {
+		for(isize b = 0; b < 64; ++b) {
+			if(jump[i] & (UINT64_C(1) << b)) {
+				x ^= r->x;
+				y ^= r->y;
+			}
+			rand_xoroshift(r);
+		}
+	}
+	r->x = x;
+	r->y = y;
+}
+
+//Stream n of a seed: the seed's state jumped n times
+void randomstate_init_stream(RandomState* r, u64 seed, u32 stream)
+{
+	randomstate_init(r, seed);
+	for(u32 i = 0; i < stream; ++i) {
+		rand_jump(r);
+	}
+}
+
+//The top bits go in the mantissa of a float in [1, 2), and 1 comes off, for
+//[0, 1) with no divide; the low bits of xoroshiro128+ are the weak ones
+static inline
+f64 rand_bits_to_f64(u64 x)
+{
+	u64 bits = (x >> 12) | UINT64_C(0x3FF0000000000000);
+	f64 f;
+	memcpy(&f, &bits, sizeof(f64));
+	return f - 1.0;
+}
+
+static inline
+f32 rand_bits_to_f32(u64 x)
+{
+	u32 bits = (u32)(x >> 41) | 0x3F800000u;
+	f32 f;
+	memcpy(&f, &bits, sizeof(f32));
+	return f - 1.0f;
+}
+
 static inline
 f64 rand_f64(RandomState* r)
 {
-	u64 x = rand_xoroshift(r);
-	return (f64)x / UINT64_MAX;
+	return rand_bits_to_f64(rand_xoroshift(r));
 }
 
 static inline
 f32 rand_f32(RandomState* r)
 {
-	return (f32)rand_f64(r);
+	return rand_bits_to_f32(rand_xoroshift(r));
 }
 
 static inline
@@ -61,9 +109,240 @@ f32 rand_range(RandomState* r, f32 min, f32 max)
 	return rand_f64(r) * (max - min) + min;
 }
 
+//Lemire's multiply-shift: the high half of a 32x32 bit multiply of x by
+//range is the answer, and the low half says whether x is one of the few
+//values that would favour some results, in which case this returns false
+//and x has to be drawn again. That check only needs a divide when it might
+//be true.
+static inline
+i32 rand_bounded_try(u32 x, u32 range, u32* out)
+{
+	u64 m = (u64)x * range;
+	u32 low = (u32)m;
+	if(low < range && low < (0u - range) % range) return false;
+	*out = (u32)(m >> 32);
+	return true;
+}
+
+//[0, range), range > 0, with no bias
+static inline
+u32 rand_bounded(RandomState* r, u32 range)
+{
+	u32 result;
+	while(!rand_bounded_try((u32)(rand_xoroshift(r) >> 32), range, &result));
+	return result;
+}
+
+//min to max, both inclusive
 static inline
 i32 rand_range_int(RandomState* r, i32 min, i32 max)
 {
-	return (i32)(rand_f64(r) * ((max + 1) - min) + min);
+	u32 range = (u32)max - (u32)min + 1;
+	//The whole of i32
+	if(range == 0) return (i32)(rand_xoroshift(r) >> 32);
+	return (i32)((u32)min + rand_bounded(r, range));
+}
+
+//Fisher-Yates
+void rand_shuffle(RandomState* r, i32* array, isize count)
+{
+	for(isize i = count - 1; i > 0; --i) {
+		isize j = rand_bounded(r, (u32)(i + 1));
+		i32 tmp = array[i];
+		array[i] = array[j];
+		array[j] = tmp;
+	}
+}
+
+//Only the first k steps of a forward Fisher-Yates, so the first k elements
+//are a uniform sample of the whole array, without repeats, in O(k). Returns
+//how many there are, which is k unless the array is shorter.
+isize rand_sample(RandomState* r, i32* array, isize count, isize k)
+{
+	if(k > count) k = count;
+	for(isize i = 0; i < k; ++i) {
+		isize j = i + rand_bounded(r, (u32)(count - i));
+		i32 tmp = array[i];
+		array[i] = array[j];
+		array[j] = tmp;
+	}
+	return k;
 }
 
+
+/* Bulk generation
+ *
+ * RandomLanes is RandomLaneCount xoroshiro128+ states side by side, each
+ * one jump apart, stepped together so the whole thing fits in SIMD
+ * registers: two SSE2 registers' worth, or one AVX2 one when ld_batch.c
+ * has picked AVX2. Output is lane 0, 1, 2, 3, then lane 0 again, and so on,
+ * and it's the same numbers whichever code path made them.
+ *
+ * The fill functions always step every lane, so a count that isn't a
+ * multiple of RandomLaneCount throws the rest of the last step away.
+ */
+
+#define RandomLaneCount 4
+#define RandomFillChunk 256
+
+typedef struct RandomLanes_
+{
+	u64 x[RandomLaneCount];
+	u64 y[RandomLaneCount];
+} RandomLanes;
+
+void random_lanes_init(RandomLanes* lanes, u64 seed)
+{
+	RandomState r;
+	randomstate_init(&r, seed);
+	for(isize i = 0; i < RandomLaneCount; ++i) {
+		lanes->x[i] = r.x;
+		lanes->y[i] = r.y;
+		rand_jump(&r);
+	}
+}
+
+static
+isize random_lanes_fill_scalar(RandomLanes* lanes, u64* out, isize count)
+{
+	isize i = 0;
+	for(; i + RandomLaneCount <= count; i += RandomLaneCount) {
+		for(isize lane = 0; lane < RandomLaneCount; ++lane) {
+			u64 a = lanes->x[lane];
+			u64 b = lanes->y[lane];
+			out[i + lane] = a + b;
+			b ^= a;
+			lanes->x[lane] = rand_rotate_left(a, 55) ^ b ^ (b << 14);
+			lanes->y[lane] = rand_rotate_left(b, 36);
+		}
+	}
+	return i;
+}
+
+#ifdef BATCH_SSE2
+static
+isize random_lanes_fill_sse2(RandomLanes* lanes, u64* out, isize count)
+{
+	__m128i x0 = _mm_loadu_si128((__m128i*)lanes->x);
+	__m128i x1 = _mm_loadu_si128((__m128i*)(lanes->x + 2));
+	__m128i y0 = _mm_loadu_si128((__m128i*)lanes->y);
+	__m128i y1 = _mm_loadu_si128((__m128i*)(lanes->y + 2));
+	isize i = 0;
+	for(; i + RandomLaneCount <= count; i += RandomLaneCount) {
+		_mm_storeu_si128((__m128i*)(out + i), _mm_add_epi64(x0, y0));
+		_mm_storeu_si128((__m128i*)(out + i + 2), _mm_add_epi64(x1, y1));
+		y0 = _mm_xor_si128(y0, x0);
+		y1 = _mm_xor_si128(y1, x1);
+		x0 = _mm_xor_si128(_mm_xor_si128(_mm_or_si128(_mm_slli_epi64(x0, 55), _mm_srli_epi64(x0, 9)), y0), 
+				_mm_slli_epi64(y0, 14));
+		x1 = _mm_xor_si128(_mm_xor_si128(_mm_or_si128(_mm_slli_epi64(x1, 55), _mm_srli_epi64(x1, 9)), y1), 
+				_mm_slli_epi64(y1, 14));
+		y0 = _mm_or_si128(_mm_slli_epi64(y0, 36), _mm_srli_epi64(y0, 28));
+		y1 = _mm_or_si128(_mm_slli_epi64(y1, 36), _mm_srli_epi64(y1, 28));
+	}
+	_mm_storeu_si128((__m128i*)lanes->x, x0);
+	_mm_storeu_si128((__m128i*)(lanes->x + 2), x1);
+	_mm_storeu_si128((__m128i*)lanes->y, y0);
+	_mm_storeu_si128((__m128i*)(lanes->y + 2), y1);
+	return i;
+}
+#endif
+
+#ifdef BATCH_AVX2
+static BatchAvx2Target
+isize random_lanes_fill_avx2(RandomLanes* lanes, u64* out, isize count)
+{
+	__m256i x = _mm256_loadu_si256((__m256i*)lanes->x);
+	__m256i y = _mm256_loadu_si256((__m256i*)lanes->y);
+	isize i = 0;
+	for(; i + RandomLaneCount <= count; i += RandomLaneCount) {
+		_mm256_storeu_si256((__m256i*)(out + i), _mm256_add_epi64(x, y));
+		y = _mm256_xor_si256(y, x);
+		x = _mm256_xor_si256(_mm256_xor_si256(_mm256_or_si256(_mm256_slli_epi64(x, 55), _mm256_srli_epi64(x, 9)), y),
+				_mm256_slli_epi64(y, 14));
+		y = _mm256_or_si256(_mm256_slli_epi64(y, 36), _mm256_srli_epi64(y, 28));
+	}
+	_mm256_storeu_si256((__m256i*)lanes->x, x);
+	_mm256_storeu_si256((__m256i*)lanes->y, y);
+	return i;
+}
+#endif
+
+void rand_fill_u64(RandomLanes* lanes, u64* out, isize count)
+{
+	isize done;
+#ifdef BATCH_AVX2
+	if(batch_level == Batch_AVX2) {
+		done = random_lanes_fill_avx2(lanes, out, count);
+	} else
+#endif
+#ifdef BATCH_SSE2
+	if(batch_level >= Batch_SSE2) {
+		done = random_lanes_fill_sse2(lanes, out, count);
+	} else
+#endif
+	{
+		done = random_lanes_fill_scalar(lanes, out, count);
+	}
+
+	if(done < count) {
+		u64 last[RandomLaneCount];
+		random_lanes_fill_scalar(lanes, last, RandomLaneCount);
+		memcpy(out + done, last, sizeof(u64) * (count - done));
+	}
+}
+
+//The rest go through a buffer of u64s, a chunk at a time
+void rand_fill_u32(RandomLanes* lanes, u32* out, isize count)
+{
+	u64 buf[RandomFillChunk];
+	for(isize start = 0; start < count; start += RandomFillChunk) {
+		isize n = count - start < RandomFillChunk ? count - start : RandomFillChunk;
+		rand_fill_u64(lanes, buf, n);
+		for(isize i = 0; i < n; ++i) {
+			out[start + i] = (u32)(buf[i] >> 32);
+		}
+	}
+}
+
+//[0, 1)
+void rand_fill_f32(RandomLanes* lanes, f32* out, isize count)
+{
+	u64 buf[RandomFillChunk];
+	for(isize start = 0; start < count; start += RandomFillChunk) {
+		isize n = count - start < RandomFillChunk ? count - start : RandomFillChunk;
+		rand_fill_u64(lanes, buf, n);
+		for(isize i = 0; i < n; ++i) {
+			out[start + i] = rand_bits_to_f32(buf[i]);
+		}
+	}
+}
+
+//min to max inclusive, with no bias, like rand_range_int. The rare draw
+//rand_bounded_try turns down is replaced from a few spare lane steps.
+void rand_fill_range_int(RandomLanes* lanes, i32* out, isize count, i32 min, i32 max)
+{
+	u32 range = (u32)max - (u32)min + 1;
+	u64 buf[RandomFillChunk];
+	u64 spare[RandomLaneCount];
+	isize spare_count = 0;
+	for(isize start = 0; start < count; start += RandomFillChunk) {
+		isize n = count - start < RandomFillChunk ? count - start : RandomFillChunk;
+		rand_fill_u64(lanes, buf, n);
+		for(isize i = 0; i < n; ++i) {
+			u32 x = (u32)(buf[i] >> 32);
+			u32 result = x;
+			//range is 0 for the whole of i32, where every x will do
+			if(range != 0) {
+				while(!rand_bounded_try(x, range, &result)) {
+					if(spare_count == 0) {
+						rand_fill_u64(lanes, spare, RandomLaneCount);
+						spare_count = RandomLaneCount;
+					}
+					x = (u32)(spare[--spare_count] >> 32);
+				}
+			}
+			out[start + i] = (i32)((u32)min + result);
+		}
+	}
+}
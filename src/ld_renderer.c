@@ -83,9 +83,11 @@ void sprite_group_init(SpriteGroup* group, Sprite* sprites, isize capacity)
 	group->capacity = capacity;
 	group->count = 0;
 
+	//1x1 until a texture is set, so render_add doesn't divide by zero
+	//while the real one is still streaming in
 	group->texture = 0;
-	group->texture_width = 0;
-	group->texture_height = 0;
+	group->texture_width = 1;
+	group->texture_height = 1;
 
 	group->offset = v2(0, 0);
 }
@@ -100,6 +102,9 @@ typedef struct SpriteRenderer_
 	isize u_ortho_matrix;
 	isize u_scale;
 
+	//Where linked program binaries are kept between runs; NULL disables it
+	string program_cache_dir;
+
 	SpriteGroup* groups;
 	isize group_count;
 } SpriteRenderer;
@@ -123,6 +128,238 @@ void sprite_renderer_set_texture(SpriteRenderer* render, u32 texture, i32 width,
 	}
 }
 
+/* Program binary cache
+ *
+ * Linked programs are saved with glGetProgramBinary and loaded back with
+ * glProgramBinary on the next launch, which skips the driver's GLSL compile.
+ * Files are named by a hash of both sources and the GL vendor, renderer and
+ * version strings, so a shader edit or a driver update just misses the cache.
+ *
+ * glad is generated for 3.3 core, so these (4.1 / ARB_get_program_binary)
+ * entry points are loaded by hand.
+ */
+
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+
+#define ProgramCacheMagic 0x42505357 //"WSPB"
+
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC_)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC_)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC_)(GLuint program, GLenum pname, GLint value);
+
+static PFNGLGETPROGRAMBINARYPROC_ gl_get_program_binary;
+static PFNGLPROGRAMBINARYPROC_ gl_program_binary;
+static PFNGLPROGRAMPARAMETERIPROC_ gl_program_parameteri;
+
+//Returns 0 if either shader fails to compile or the program fails to link
+u32 sprite_renderer_compile_program(string vert_source, string frag_source)
+{
+	i32 ok = true;
+	u32 vert_shader = glCreateShader(GL_VERTEX_SHADER);
+	{
+		u32 shader = vert_shader;
+		string src = vert_source;
+
+		glShaderSource(shader, 1, &src, NULL);
+		glCompileShader(shader);
+		u32 success;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+		i32 log_size;
+		char shader_log[4096];
+		glGetShaderInfoLog(shader, 4096, &log_size, shader_log);
+		if(!success) {
+			log_error("Error: could not compile vertex shader\n\n%s\n\n", shader_log);
+			ok = false;
+		} else {
+			printf("Vertex shader compiled successfully \n");
+		}
+	}
+
+	u32 frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
+	{
+		u32 shader = frag_shader;
+		string src = frag_source;
+
+		glShaderSource(shader, 1, &src, NULL);
+		glCompileShader(shader);
+		u32 success;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+		i32 log_size;
+		char shader_log[4096];
+		glGetShaderInfoLog(shader, 4096, &log_size, shader_log);
+		if(!success) {
+			log_error("Error: could not compile fragment shader\n\n%s\n\n", shader_log);
+			ok = false;
+		} else {
+			printf("Frag shader compiled successfully \n");
+		}
+		
+	}
+	u32 program = glCreateProgram();
+	glAttachShader(program, vert_shader);
+	glAttachShader(program, frag_shader);
+	if(gl_program_parameteri != NULL) {
+		gl_program_parameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(program);
+	glDeleteShader(vert_shader);
+	glDeleteShader(frag_shader);
+
+	i32 linked;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if(!ok || !linked) {
+		char program_log[4096];
+		glGetProgramInfoLog(program, 4096, NULL, program_log);
+		log_error("Error: could not link shader program\n\n%s\n\n", program_log);
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+//Swaps in a new program; keeps the old one if program is 0
+void sprite_renderer_set_program(SpriteRenderer* render, u32 program)
+{
+	if(program == 0) return;
+	render->shaders = program;
+	glUseProgram(render->shaders);
+
+	render->u_texture_size = glGetUniformLocation(render->shaders, "u_texture_size");
+	render->u_ortho_matrix = glGetUniformLocation(render->shaders, "u_ortho_matrix");
+	render->u_scale = glGetUniformLocation(render->shaders, "u_scale");
+}
+
+typedef struct ProgramCacheHeader_
+{
+	u32 magic;
+	u32 format;
+	u64 key;
+	u32 length;
+	u32 padding;
+} ProgramCacheHeader;
+
+static
+i32 program_cache_supported()
+{
+	static i32 checked = false, supported = false;
+	if(checked) return supported;
+	checked = true;
+
+	gl_get_program_binary = SDL_GL_GetProcAddress("glGetProgramBinary");
+	gl_program_binary = SDL_GL_GetProcAddress("glProgramBinary");
+	gl_program_parameteri = SDL_GL_GetProcAddress("glProgramParameteri");
+	if(gl_get_program_binary == NULL || gl_program_binary == NULL || gl_program_parameteri == NULL) {
+		return false;
+	}
+
+	//Some drivers expose the entry points but support no formats at all
+	i32 formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	supported = formats > 0;
+	return supported;
+}
+
+static
+u64 program_cache_key(string vert_source, string frag_source)
+{
+	string parts[] = {
+		vert_source, frag_source,
+		(string)glGetString(GL_VENDOR),
+		(string)glGetString(GL_RENDERER),
+		(string)glGetString(GL_VERSION)
+	};
+	u64 key = FNV64_Basis;
+	isize count = (isize)(sizeof(parts) / sizeof(parts[0]));
+	for(isize i = 0; i < count; ++i) {
+		//include the terminator so "ab"+"c" and "a"+"bc" differ
+		if(parts[i] != NULL) key = hash_fnv64(parts[i], strlen(parts[i]) + 1, key);
+	}
+	return key;
+}
+
+static
+u32 program_cache_load(string filename, u64 key)
+{
+	isize size = 0;
+	u8* data = platform_map_file(filename, &size);
+	if(data == NULL) return 0;
+
+	u32 program = 0;
+	ProgramCacheHeader* header = (ProgramCacheHeader*)data;
+	isize header_size = (isize)sizeof(ProgramCacheHeader);
+	if(size >= header_size &&
+			header->magic == ProgramCacheMagic &&
+			header->key == key &&
+			(isize)header->length == size - header_size) {
+		program = glCreateProgram();
+		gl_program_binary(program, header->format, data + sizeof(ProgramCacheHeader), header->length);
+		i32 linked = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if(!linked) {
+			glDeleteProgram(program);
+			program = 0;
+		}
+	}
+	platform_unmap_file(data, size);
+	return program;
+}
+
+static
+void program_cache_save(string filename, u64 key, u32 program)
+{
+	i32 length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if(length <= 0) return;
+
+	u8* binary = malloc(length);
+	ProgramCacheHeader header = {0};
+	header.magic = ProgramCacheMagic;
+	header.key = key;
+	gl_get_program_binary(program, length, &length, &header.format, binary);
+	header.length = length;
+
+	FILE* fp = fopen(filename, "wb");
+	if(fp != NULL) {
+		fwrite(&header, sizeof(ProgramCacheHeader), 1, fp);
+		fwrite(binary, 1, length, fp);
+		fclose(fp);
+	} else {
+		log_error("Error: could not write program cache %s", filename);
+	}
+	free(binary);
+}
+
+//Like sprite_renderer_compile_program, but goes through the binary cache
+//when the driver and render->program_cache_dir allow it
+u32 sprite_renderer_load_program(SpriteRenderer* render, string vert_source, string frag_source)
+{
+	if(render->program_cache_dir == NULL || !program_cache_supported()) {
+		return sprite_renderer_compile_program(vert_source, frag_source);
+	}
+
+	u64 key = program_cache_key(vert_source, frag_source);
+	char filename[4096];
+	i32 length = snprintf(filename, sizeof(filename), "%sprogram_%016llx.bin",
+			render->program_cache_dir, (unsigned long long)key);
+	//A cut off path could be someone else's file
+	if(length < 0 || length >= (i32)sizeof(filename)) {
+		return sprite_renderer_compile_program(vert_source, frag_source);
+	}
+
+	u32 program = program_cache_load(filename, key);
+	if(program != 0) {
+		return program;
+	}
+
+	program = sprite_renderer_compile_program(vert_source, frag_source);
+	if(program != 0) {
+		program_cache_save(filename, key, program);
+	}
+	return program;
+}
+
 void sprite_renderer_init_gl(SpriteRenderer* render, string vert_source, string frag_source)
 {
 	glGenVertexArrays(1, &render->vao);
@@ -174,55 +411,9 @@ void sprite_renderer_init_gl(SpriteRenderer* render, string vert_source, string
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	u32 vert_shader = glCreateShader(GL_VERTEX_SHADER);
-	{
-		u32 shader = vert_shader;
-		string src = vert_source;
-
-		glShaderSource(shader, 1, &src, NULL);
-		glCompileShader(shader);
-		u32 success;
-		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-		i32 log_size;
-		char shader_log[4096];
-		glGetShaderInfoLog(shader, 4096, &log_size, shader_log);
-		if(!success) {
-			log_error("Error: could not compile vertex shader\n\n%s\n\n", shader_log);
-		} else {
-			printf("Vertex shader compiled successfully \n");
-		}
-	}
-
-	u32 frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
-	{
-		u32 shader = frag_shader;
-		string src = frag_source;
-
-		glShaderSource(shader, 1, &src, NULL);
-		glCompileShader(shader);
-		u32 success;
-		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-		i32 log_size;
-		char shader_log[4096];
-		glGetShaderInfoLog(shader, 4096, &log_size, shader_log);
-		if(!success) {
-			log_error("Error: could not compile fragment shader\n\n%s\n\n", shader_log);
-		} else {
-			printf("Frag shader compiled successfully \n");
-		}
-		
-	}
-	render->shaders = glCreateProgram();
-	glAttachShader(render->shaders, vert_shader);
-	glAttachShader(render->shaders, frag_shader);
-	glLinkProgram(render->shaders);
-	glUseProgram(render->shaders);
-	glDeleteShader(vert_shader);
-	glDeleteShader(frag_shader);
-
-	render->u_texture_size = glGetUniformLocation(render->shaders, "u_texture_size");
-	render->u_ortho_matrix = glGetUniformLocation(render->shaders, "u_ortho_matrix");
-	render->u_scale = glGetUniformLocation(render->shaders, "u_scale");
+	render->shaders = 0;
+	u32 program = sprite_renderer_load_program(render, vert_source, frag_source);
+	sprite_renderer_set_program(render, program);
 }
 
 void render_start(SpriteGroup* group)
@@ -354,7 +545,7 @@ GLuint ogl_load_texture_from_memory(u8* buf, i32 size, i32* x, i32* y)
 	u8* data = stbi_load_from_memory(buf, size, &w, &h, &n, STBI_rgb_alpha);
 	GLuint texture = ogl_add_texture(data, w, h);
 	if(texture == 0) {
-		log_error("Error loading texture\n");
+		log_error("Error loading texture: %s", data == NULL ? stbi_failure_reason() : "glTexImage2D failed");
 	}
 	if(x) *x = w;
 	if(y) *y = h;
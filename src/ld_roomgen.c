@@ -0,0 +1,199 @@
+
+/* Room generation
+ *
+ * A room is a width x height grid of cells, each holding an object kind, or
+ * 0 for nothing. room_generate puts a list of objects into different random
+ * cells from a seed, then checks the room can be solved.
+ *
+ * The path starts at config->start, which can be just off the edge of the
+ * grid, and moves a cell at a time, up, down, left or right, never into a
+ * cell whose kind is blocking. Entering a cell costs its kind's cost. With a
+ * goal_kind, the room is solvable if a cell of that kind can be reached for
+ * max_cost or less (0 is no limit), and the cheapest way there is its
+ * difficulty. Without one, every object that isn't blocking has to be
+ * reachable, and the difficulty is what it costs to get to the dearest.
+ * The costs come from one path_dijkstra over the room.
+ *
+ * room_generate_batch runs a range of seeds across the job system and only
+ * keeps a RoomSummary of each; any seed worth having can be generated again.
+ */
+
+#define RoomGenMaxCells 1024
+#define RoomGenMaxKinds 32
+
+typedef struct RoomKindRule_
+{
+	i32 cost;
+	i32 blocking;
+} RoomKindRule;
+
+typedef struct RoomGenConfig_
+{
+	i32 width, height;
+
+	//Placed in this order, one to a cell
+	const u8* objects;
+	i32 object_count;
+
+	RoomKindRule rules[RoomGenMaxKinds];
+	Vec2i start;
+	u8 goal_kind;
+	i32 max_cost;
+} RoomGenConfig;
+
+typedef struct RoomSummary_
+{
+	u64 seed;
+	i32 solvable;
+	//Of the cheapest path to the goal (or dearest object); -1 if there isn't one
+	i32 cost;
+	i32 steps;
+} RoomSummary;
+
+//Everything costs 1 and nothing blocks; starts off the middle of the right edge
+void room_gen_config_init(RoomGenConfig* config, i32 width, i32 height, const u8* objects, i32 object_count)
+{
+	memset(config, 0, sizeof(RoomGenConfig));
+	config->width = width;
+	config->height = height;
+	config->objects = objects;
+	config->object_count = object_count;
+	for(i32 i = 0; i < RoomGenMaxKinds; ++i) {
+		config->rules[i].cost = 1;
+		config->rules[i].blocking = false;
+	}
+	config->start = v2i(width, height / 2);
+}
+
+//costs needs width * height cells
+void room_path_grid(const RoomGenConfig* config, const u8* kinds, i32* costs, PathGrid* grid)
+{
+	i32 cell_count = config->width * config->height;
+	for(i32 i = 0; i < cell_count; ++i) {
+		const RoomKindRule* rule = config->rules + kinds[i];
+		costs[i] = rule->blocking ? PathBlocked : rule->cost;
+	}
+	path_grid_init(grid, config->width, config->height, costs);
+}
+
+//Fills in summary's solvable, cost and steps for a room that's already laid out
+i32 room_validate(const RoomGenConfig* config, const u8* kinds, PathFinder* pf, RoomSummary* summary)
+{
+	i32 costs[RoomGenMaxCells];
+	if(config->width * config->height > RoomGenMaxCells) return false;
+	PathGrid grid;
+	room_path_grid(config, kinds, costs, &grid);
+	if(!path_dijkstra(pf, &grid, config->start)) {
+		summary->solvable = false;
+		summary->cost = -1;
+		summary->steps = 0;
+		return false;
+	}
+	i32* cost = pf->cost;
+	i32* steps = pf->steps;
+	i32 cell_count = config->width * config->height;
+
+	i32 best = -1;
+	i32 solvable = true;
+	for(i32 i = 0; i < cell_count; ++i) {
+		u8 kind = kinds[i];
+		if(config->goal_kind != 0) {
+			if(kind != config->goal_kind || cost[i] == -1) continue;
+			if(best == -1 || cost[i] < cost[best]) best = i;
+		} else if(kind != 0 && !config->rules[kind].blocking) {
+			if(cost[i] == -1) {
+				solvable = false;
+				best = -1;
+				break;
+			}
+			if(best == -1 || cost[i] > cost[best]) best = i;
+		}
+	}
+
+	if(best == -1) {
+		solvable = false;
+	} else if(config->max_cost > 0 && cost[best] > config->max_cost) {
+		solvable = false;
+	}
+	summary->solvable = solvable;
+	summary->cost = best != -1 ? cost[best] : -1;
+	summary->steps = best != -1 ? steps[best] : 0;
+	return solvable;
+}
+
+//kinds needs width * height cells, and pf at least that many. Returns whether
+//the room is solvable; false for a config it can't lay out at all, with
+//kinds left alone.
+i32 room_generate(const RoomGenConfig* config, u64 seed, PathFinder* pf, u8* kinds, RoomSummary* summary)
+{
+	i32 cell_count = config->width * config->height;
+	summary->seed = seed;
+	summary->solvable = false;
+	summary->cost = -1;
+	summary->steps = 0;
+	if(config->width <= 0 || config->height <= 0 || cell_count > RoomGenMaxCells || cell_count > pf->max_cells) {
+		log_error("Error: can't generate a %dx%d room", config->width, config->height);
+		return false;
+	}
+	if(config->object_count > cell_count) {
+		log_error("Error: %d objects won't fit in %d cells", config->object_count, cell_count);
+		return false;
+	}
+
+	RandomState r;
+	randomstate_init(&r, seed);
+	rand_xoroshift(&r);
+
+	i32 cells[RoomGenMaxCells];
+	for(i32 i = 0; i < cell_count; ++i) {
+		cells[i] = i;
+	}
+	rand_sample(&r, cells, cell_count, config->object_count);
+
+	memset(kinds, 0, cell_count);
+	for(i32 i = 0; i < config->object_count; ++i) {
+		kinds[cells[i]] = config->objects[i] < RoomGenMaxKinds ? config->objects[i] : 0;
+	}
+	return room_validate(config, kinds, pf, summary);
+}
+
+typedef struct RoomBatch_
+{
+	const RoomGenConfig* config;
+	JobSystem* jobs;
+	//One for each worker
+	PathFinder finders[JobMaxThreads];
+	u64 first_seed;
+	RoomSummary* results;
+} RoomBatch;
+
+static
+void room_batch_job(void* data, i32 start, i32 end)
+{
+	RoomBatch* batch = data;
+	//Off the job system, everything runs inline on the one thread
+	JobWorker* w = job_current_worker(batch->jobs);
+	PathFinder* pf = batch->finders + (w != NULL ? w->index : 0);
+	u8 kinds[RoomGenMaxCells];
+	for(i32 i = start; i < end; ++i) {
+		room_generate(batch->config, batch->first_seed + i, pf, kinds, batch->results + i);
+	}
+}
+
+//Seeds first_seed to first_seed + count - 1; results[i] is first_seed + i.
+//Each thread's PathFinder comes off arena.
+void room_generate_batch(JobSystem* jobs, const RoomGenConfig* config, MemoryArena* arena,
+		u64 first_seed, i32 count, RoomSummary* results)
+{
+	RoomBatch* batch = arena_push(arena, sizeof(RoomBatch));
+	if(batch == NULL) return;
+	batch->config = config;
+	batch->jobs = jobs;
+	batch->first_seed = first_seed;
+	batch->results = results;
+	for(i32 i = 0; i < jobs->thread_count; ++i) {
+		if(!pathfinder_init(batch->finders + i, arena, config->width * config->height)) return;
+	}
+	job_parallel_for(jobs, count, 0, room_batch_job, batch);
+}
+
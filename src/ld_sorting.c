@@ -36,28 +36,87 @@ void func_name(T* array, isize count) \
 	} \
 }
 
-#define GenerateIntrosortForType(func_name, T, Cutoff, Member_Macro) \
+//Sift-down heapsort; introsort falls back on it, but it's fine on its own
+//when the worst case matters more than the average
+#define GenerateHeapsortForType(func_name, T, Member_Macro) \
+static void func_name##_sift(T* array, isize root, isize count) \
+{ \
+	T x = array[root]; \
+	for(;;) { \
+		isize child = root * 2 + 1; \
+		if(child >= count) break; \
+		if(child + 1 < count && Member_Macro(array[child]) < Member_Macro(array[child + 1])) { \
+			child++; \
+		} \
+		if(!(Member_Macro(x) < Member_Macro(array[child]))) break; \
+		array[root] = array[child]; \
+		root = child; \
+	} \
+	array[root] = x; \
+} \
 void func_name(T* array, isize count) \
 { \
-	if(count > 1) \
-	if(count > Cutoff) { \
+	for(isize i = count / 2 - 1; i >= 0; --i) { \
+		func_name##_sift(array, i, count); \
+	} \
+	for(isize end = count - 1; end > 0; --end) { \
 		T tmp = array[0]; \
-		array[0] = array[count / 2]; \
-		array[count / 2] = tmp; \
-		isize pivot = 0; \
-		for(isize i = 1; i < count; ++i) { \
-			if(Member_Macro(array[i]) < Member_Macro(array[0])) { \
-				tmp = array[++pivot]; \
-				array[pivot] = array[i]; \
-				array[i] = tmp; \
-			} \
+		array[0] = array[end]; \
+		array[end] = tmp; \
+		func_name##_sift(array, 0, end); \
+	} \
+}
+
+//Quicksort on a median of three, with a Hoare partition so runs of equal
+//keys split down the middle instead of all going one way. Recurses on the
+//smaller side only, and after 2 log n levels of bad pivots switches that
+//range to heapsort, so it's n log n whatever the input. Ranges of Cutoff or
+//less are left for one insertion sort pass over everything at the end.
+#define GenerateIntrosortForType(func_name, T, Cutoff, Member_Macro) \
+GenerateHeapsortForType(func_name##_heapsort, T, Member_Macro) \
+static void func_name##_loop(T* array, isize count, isize depth) \
+{ \
+	while(count > Cutoff && count > 2) { \
+		if(depth-- == 0) { \
+			func_name##_heapsort(array, count); \
+			return; \
 		} \
-		tmp = array[0]; \
-		array[0] = array[pivot]; \
-		array[pivot] = tmp; \
-		func_name(array, pivot); \
-		func_name(array + pivot + 1, count - (pivot + 1)); \
-	} else for(isize i = 1; i < count; ++i) { \
+		isize mid = (count - 1) / 2, last = count - 1; \
+		T tmp; \
+		if(Member_Macro(array[mid]) < Member_Macro(array[0])) { \
+			tmp = array[mid]; array[mid] = array[0]; array[0] = tmp; \
+		} \
+		if(Member_Macro(array[last]) < Member_Macro(array[0])) { \
+			tmp = array[last]; array[last] = array[0]; array[0] = tmp; \
+		} \
+		if(Member_Macro(array[last]) < Member_Macro(array[mid])) { \
+			tmp = array[last]; array[last] = array[mid]; array[mid] = tmp; \
+		} \
+		T pivot = array[mid]; \
+		isize i = -1, j = count; \
+		for(;;) { \
+			do { i++; } while(Member_Macro(array[i]) < Member_Macro(pivot)); \
+			do { j--; } while(Member_Macro(pivot) < Member_Macro(array[j])); \
+			if(i >= j) break; \
+			tmp = array[i]; array[i] = array[j]; array[j] = tmp; \
+		} \
+		isize left = j + 1; \
+		if(left < count - left) { \
+			func_name##_loop(array, left, depth); \
+			array += left; \
+			count -= left; \
+		} else { \
+			func_name##_loop(array + left, count - left, depth); \
+			count = left; \
+		} \
+	} \
+} \
+void func_name(T* array, isize count) \
+{ \
+	isize depth = 0; \
+	for(isize n = count; n > 1; n >>= 1) depth += 2; \
+	func_name##_loop(array, count, depth); \
+	for(isize i = 1; i < count; ++i) { \
 		T x = array[i]; \
 		isize j = i - 1; \
 		while((j >= 0) && (Member_Macro(array[j]) > Member_Macro(x))) { \
@@ -68,6 +127,140 @@ void func_name(T* array, isize count) \
 	} \
 }
 
+/* Radix sort
+ *
+ * LSD, a byte at a time, stable. Member_Key_Macro gives an unsigned key of
+ * type K (u32 or u64); the radix_key_ helpers turn signed ints and floats
+ * into keys that sort the same way. All the byte histograms are counted in
+ * one pass up front, and a byte that's the same in every key is skipped.
+ * scratch needs room for count elements; the result ends up in array.
+ */
+
+static inline
+u32 radix_key_i32(i32 x)
+{
+	return (u32)x ^ 0x80000000u;
+}
+
+static inline
+u64 radix_key_i64(i64 x)
+{
+	return (u64)x ^ 0x8000000000000000ull;
+}
+
+//Negative floats have every bit flipped so bigger magnitudes sort first,
+//positive ones just the sign bit so they sort after all the negatives
+static inline
+u32 radix_key_f32(f32 f)
+{
+	u32 u;
+	memcpy(&u, &f, sizeof(u32));
+	return u ^ ((u32)-(i32)(u >> 31) | 0x80000000u);
+}
+
+static inline
+u64 radix_key_f64(f64 f)
+{
+	u64 u;
+	memcpy(&u, &f, sizeof(u64));
+	return u ^ ((u64)-(i64)(u >> 63) | 0x8000000000000000ull);
+}
+
+#define GenerateRadixSortForType(func_name, T, K, Member_Key_Macro) \
+void func_name(T* array, T* scratch, isize count) \
+{ \
+	if(count < 2) return; \
+	isize counts[sizeof(K)][256]; \
+	memset(counts, 0, sizeof(counts)); \
+	for(isize i = 0; i < count; ++i) { \
+		K key = Member_Key_Macro(array[i]); \
+		for(isize d = 0; d < (isize)sizeof(K); ++d) { \
+			counts[d][(key >> (d * 8)) & 0xFF]++; \
+		} \
+	} \
+	T* src = array; \
+	T* dst = scratch; \
+	for(isize d = 0; d < (isize)sizeof(K); ++d) { \
+		isize* c = counts[d]; \
+		if(c[(Member_Key_Macro(src[0]) >> (d * 8)) & 0xFF] == count) continue; \
+		isize total = 0; \
+		for(isize b = 0; b < 256; ++b) { \
+			isize n = c[b]; \
+			c[b] = total; \
+			total += n; \
+		} \
+		for(isize i = 0; i < count; ++i) { \
+			K key = Member_Key_Macro(src[i]); \
+			dst[c[(key >> (d * 8)) & 0xFF]++] = src[i]; \
+		} \
+		T* tmp = src; \
+		src = dst; \
+		dst = tmp; \
+	} \
+	if(src != array) { \
+		memcpy(array, src, sizeof(T) * count); \
+	} \
+}
+
+/* Parallel merge sort
+ *
+ * Splits in half, sorts the left half as a job while this thread does the
+ * right, then merges the two through scratch (room for count elements).
+ * Ranges of Cutoff or less, and any of one, are introsorted on whatever
+ * thread has them, so it isn't stable. Merging two halves that are already
+ * in order is skipped. The merges themselves are serial, so the last one is
+ * an O(n) pass on one thread; the sorting under it is what gets spread out.
+ */
+#define GenerateParallelMergeSortForType(func_name, T, Cutoff, Member_Macro) \
+GenerateIntrosortForType(func_name##_serial, T, 16, Member_Macro) \
+typedef struct func_name##_Task_ \
+{ \
+	JobSystem* jobs; \
+	T* array; \
+	T* scratch; \
+	isize count; \
+} func_name##_Task; \
+static void func_name##_task(void* data, i32 start, i32 end); \
+static void func_name##_run(JobSystem* jobs, T* array, T* scratch, isize count) \
+{ \
+	if(count <= Cutoff || count < 2) { \
+		func_name##_serial(array, count); \
+		return; \
+	} \
+	isize half = count / 2; \
+	func_name##_Task left; \
+	left.jobs = jobs; \
+	left.array = array; \
+	left.scratch = scratch; \
+	left.count = half; \
+	JobCounter counter; \
+	job_counter_init(&counter); \
+	job_run(jobs, func_name##_task, &left, &counter); \
+	func_name##_run(jobs, array + half, scratch + half, count - half); \
+	job_wait(jobs, &counter); \
+	if(!(Member_Macro(array[half]) < Member_Macro(array[half - 1]))) return; \
+	isize a = 0, b = half, out = 0; \
+	while(a < half && b < count) { \
+		if(Member_Macro(array[b]) < Member_Macro(array[a])) { \
+			scratch[out++] = array[b++]; \
+		} else { \
+			scratch[out++] = array[a++]; \
+		} \
+	} \
+	while(a < half) scratch[out++] = array[a++]; \
+	while(b < count) scratch[out++] = array[b++]; \
+	memcpy(array, scratch, sizeof(T) * count); \
+} \
+static void func_name##_task(void* data, i32 start, i32 end) \
+{ \
+	func_name##_Task* task = data; \
+	func_name##_run(task->jobs, task->array, task->scratch, task->count); \
+} \
+void func_name(JobSystem* jobs, T* array, T* scratch, isize count) \
+{ \
+	func_name##_run(jobs, array, scratch, count); \
+}
+
 #define GenerateBinarySearchForType(func_name, T, K, Member_Key_Macro) \
 isize func_name(K key, T* array, isize count) \
 { \
@@ -89,3 +282,150 @@ isize func_name(K key, T* array, isize count) \
 } 
  
 
+
+/* Searching sorted arrays
+ *
+ * Lower bound is the first element whose key isn't less than key, upper
+ * bound the first that's greater; both give count if there isn't one. The
+ * loop halves the range a fixed number of times with a conditional move
+ * rather than a branch, so there's nothing for the CPU to mispredict.
+ */
+#define GenerateLowerBoundForType(func_name, T, K, Member_Key_Macro) \
+isize func_name(K key, T* array, isize count) \
+{ \
+	if(count == 0) return 0; \
+	T* base = array; \
+	while(count > 1) { \
+		isize half = count / 2; \
+		base = (Member_Key_Macro(base[half]) < key) ? base + half : base; \
+		count -= half; \
+	} \
+	return (base - array) + (Member_Key_Macro(*base) < key); \
+}
+
+#define GenerateUpperBoundForType(func_name, T, K, Member_Key_Macro) \
+isize func_name(K key, T* array, isize count) \
+{ \
+	if(count == 0) return 0; \
+	T* base = array; \
+	while(count > 1) { \
+		isize half = count / 2; \
+		base = (key < Member_Key_Macro(base[half])) ? base : base + half; \
+		count -= half; \
+	} \
+	return (base - array) + !(key < Member_Key_Macro(*base)); \
+}
+
+//For arrays of a few dozen elements, counting everything less than key
+//beats any kind of halving, and the compiler can vectorize it
+#define GenerateLinearLowerBoundForType(func_name, T, K, Member_Key_Macro) \
+isize func_name(K key, T* array, isize count) \
+{ \
+	isize result = 0; \
+	for(isize i = 0; i < count; ++i) { \
+		result += Member_Key_Macro(array[i]) < key; \
+	} \
+	return result; \
+}
+
+/* Eytzinger layout
+ *
+ * For big tables that get searched a lot: the sorted array stored as an
+ * implicit binary tree in breadth first order, 1-indexed (slot 0 is unused,
+ * so eytzinger needs count + 1 slots), so the first few levels of every
+ * search share the same few cache lines, and the next levels down can be
+ * prefetched a few steps ahead. func_name##_build fills it in from a
+ * sorted array; func_name gives the slot of the lower bound, or 0 if every
+ * key is less.
+ */
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SORTING_SSE2
+#include <emmintrin.h>
+#define SortingPrefetch(p) _mm_prefetch((const char*)(p), _MM_HINT_T0)
+#else
+#define SortingPrefetch(p)
+#endif
+
+//Going right is a 1 bit and left a 0; the answer is where the search last
+//went left, so drop the trailing rights and that one left
+static inline
+isize eytzinger_resolve(isize k)
+{
+	while(k & 1) k >>= 1;
+	return k >> 1;
+}
+
+#define GenerateEytzingerSearchForType(func_name, T, K, Member_Key_Macro) \
+static isize func_name##_fill(T* sorted, T* eytzinger, isize count, isize i, isize k) \
+{ \
+	if(k <= count) { \
+		i = func_name##_fill(sorted, eytzinger, count, i, 2 * k); \
+		eytzinger[k] = sorted[i++]; \
+		i = func_name##_fill(sorted, eytzinger, count, i, 2 * k + 1); \
+	} \
+	return i; \
+} \
+void func_name##_build(T* sorted, T* eytzinger, isize count) \
+{ \
+	func_name##_fill(sorted, eytzinger, count, 0, 1); \
+} \
+isize func_name(K key, T* eytzinger, isize count) \
+{ \
+	isize k = 1; \
+	while(k <= count) { \
+		SortingPrefetch((const char*)eytzinger + (usize)k * 16 * sizeof(T)); \
+		k = 2 * k + (Member_Key_Macro(eytzinger[k]) < key); \
+	} \
+	return eytzinger_resolve(k); \
+}
+
+/* SIMD linear search
+ *
+ * Plain arrays of 32 bit keys, four at a time. search_find_u32 is for
+ * unsorted ones, search_lower_bound_i32 for small sorted ones (the count of
+ * keys less than key, like GenerateLinearLowerBoundForType).
+ */
+
+//First index of key, or -1
+isize search_find_u32(u32 key, const u32* keys, isize count)
+{
+	isize i = 0;
+#ifdef SORTING_SSE2
+	__m128i k = _mm_set1_epi32((i32)key);
+	for(; i + 4 <= count; i += 4) {
+		i32 mask = _mm_movemask_ps(_mm_castsi128_ps(
+				_mm_cmpeq_epi32(k, _mm_loadu_si128((const __m128i*)(keys + i)))));
+		if(mask != 0) {
+			for(i32 j = 0; j < 4; ++j) {
+				if(mask & (1 << j)) return i + j;
+			}
+		}
+	}
+#endif
+	for(; i < count; ++i) {
+		if(keys[i] == key) return i;
+	}
+	return -1;
+}
+
+isize search_lower_bound_i32(i32 key, const i32* keys, isize count)
+{
+	isize result = 0;
+	isize i = 0;
+#ifdef SORTING_SSE2
+	__m128i k = _mm_set1_epi32(key);
+	__m128i less = _mm_setzero_si128();
+	//Each compare is -1 where keys[i] < key, so subtracting counts them
+	for(; i + 4 <= count; i += 4) {
+		less = _mm_sub_epi32(less, _mm_cmplt_epi32(_mm_loadu_si128((const __m128i*)(keys + i)), k));
+	}
+	i32 lanes[4];
+	_mm_storeu_si128((__m128i*)lanes, less);
+	result = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+	for(; i < count; ++i) {
+		result += keys[i] < key;
+	}
+	return result;
+}
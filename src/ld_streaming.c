@@ -0,0 +1,242 @@
+
+/* Asynchronous asset loading
+ *
+ * asset_stream_* returns a handle right away and starts a job that pulls the
+ * bytes out of the asset pack (inflating if needed) and decodes them (PNG ->
+ * RGBA for textures), so decoding spreads over the job system's workers.
+ * Anything that needs GL is left for the main thread: asset_streamer_finalize
+ * uploads decoded requests until its time budget runs out, and is called
+ * once per frame.
+ *
+ * Asking for the same asset twice gives back the same handle.
+ */
+
+#define AssetStreamerMaxRequests 256
+
+typedef i32 AssetHandle;
+
+typedef enum AssetKind_
+{
+	AssetKind_Raw,
+	AssetKind_Texture
+} AssetKind;
+
+typedef enum AssetStatus_
+{
+	AssetStatus_Queued,
+	AssetStatus_Decoding,
+	AssetStatus_Decoded,
+	AssetStatus_Ready,
+	AssetStatus_Failed
+} AssetStatus;
+
+struct AssetRequest_;
+typedef void (*AssetReadyProc)(struct AssetRequest_* request, void* userdata);
+
+typedef struct AssetRequest_
+{
+	string name;
+	AssetKind kind;
+	SDL_atomic_t status;
+
+	//Borrowed from the pack
+	void* data;
+	isize size;
+
+	//AssetKind_Texture; pixels are freed once they're uploaded
+	u8* pixels;
+	i32 width;
+	i32 height;
+	u32 texture;
+
+	AssetReadyProc on_ready;
+	void* userdata;
+
+	//For the decode job
+	struct AssetStreamer_* streamer;
+} AssetRequest;
+
+typedef struct AssetStreamer_
+{
+	AssetPack* pack;
+
+	AssetRequest* requests;
+	i32 request_count;
+
+	JobSystem* jobs;
+	JobCounter decoding;
+
+	//Request indices, at most AssetStreamerMaxRequests long
+	SDL_mutex* lock;
+	i32* done_queue;
+	i32 done_head, done_tail;
+} AssetStreamer;
+
+static
+void asset_decode(AssetStreamer* streamer, AssetRequest* r)
+{
+	r->data = asset_pack_get(streamer->pack, r->name, &r->size);
+	if(r->data == NULL) {
+		SDL_AtomicSet(&r->status, AssetStatus_Failed);
+		return;
+	}
+
+	if(r->kind == AssetKind_Texture) {
+		i32 n;
+		r->pixels = stbi_load_from_memory(r->data, r->size, &r->width, &r->height, &n, STBI_rgb_alpha);
+		if(r->pixels == NULL) {
+			log_error("Error: could not decode %s: %s", r->name, stbi_failure_reason());
+			SDL_AtomicSet(&r->status, AssetStatus_Failed);
+			return;
+		}
+	}
+
+	//SDL_AtomicSet is a full barrier, so everything above is visible
+	//to whoever sees the new status
+	SDL_AtomicSet(&r->status, AssetStatus_Decoded);
+}
+
+static
+void asset_decode_job(void* data, i32 start, i32 end)
+{
+	AssetRequest* r = data;
+	AssetStreamer* streamer = r->streamer;
+	SDL_AtomicSet(&r->status, AssetStatus_Decoding);
+	asset_decode(streamer, r);
+
+	SDL_LockMutex(streamer->lock);
+	streamer->done_queue[streamer->done_tail++ % AssetStreamerMaxRequests] = (i32)(r - streamer->requests);
+	SDL_UnlockMutex(streamer->lock);
+}
+
+void asset_streamer_init(AssetStreamer* streamer, AssetPack* pack, JobSystem* jobs, MemoryArena* arena)
+{
+	streamer->pack = pack;
+	streamer->jobs = jobs;
+	job_counter_init(&streamer->decoding);
+	streamer->requests = arena_push(arena, sizeof(AssetRequest) * AssetStreamerMaxRequests);
+	streamer->request_count = 0;
+	streamer->done_queue = arena_push(arena, sizeof(i32) * AssetStreamerMaxRequests);
+	streamer->done_head = streamer->done_tail = 0;
+	streamer->lock = SDL_CreateMutex();
+}
+
+//Finishes any decodes still going first
+void asset_streamer_shutdown(AssetStreamer* streamer)
+{
+	job_wait(streamer->jobs, &streamer->decoding);
+	SDL_DestroyMutex(streamer->lock);
+}
+
+AssetHandle asset_stream(AssetStreamer* streamer, string name, AssetKind kind, AssetReadyProc on_ready, void* userdata)
+{
+	for(i32 i = 0; i < streamer->request_count; ++i) {
+		AssetRequest* r = streamer->requests + i;
+		if(r->kind == kind && strcmp(r->name, name) == 0) {
+			return i;
+		}
+	}
+
+	if(streamer->request_count >= AssetStreamerMaxRequests) {
+		log_error("Error: too many asset requests, could not load %s", name);
+		return -1;
+	}
+
+	AssetHandle handle = streamer->request_count++;
+	AssetRequest* r = streamer->requests + handle;
+	memset(r, 0, sizeof(AssetRequest));
+	r->name = name;
+	r->kind = kind;
+	r->on_ready = on_ready;
+	r->userdata = userdata;
+	r->streamer = streamer;
+	SDL_AtomicSet(&r->status, AssetStatus_Queued);
+
+	job_run(streamer->jobs, asset_decode_job, r, &streamer->decoding);
+	return handle;
+}
+
+static inline
+AssetHandle asset_stream_raw(AssetStreamer* streamer, string name, AssetReadyProc on_ready, void* userdata)
+{
+	return asset_stream(streamer, name, AssetKind_Raw, on_ready, userdata);
+}
+
+static inline
+AssetHandle asset_stream_texture(AssetStreamer* streamer, string name, AssetReadyProc on_ready, void* userdata)
+{
+	return asset_stream(streamer, name, AssetKind_Texture, on_ready, userdata);
+}
+
+static inline
+AssetRequest* asset_get_request(AssetStreamer* streamer, AssetHandle handle)
+{
+	if(handle < 0 || handle >= streamer->request_count) return NULL;
+	return streamer->requests + handle;
+}
+
+static inline
+AssetStatus asset_get_status(AssetStreamer* streamer, AssetHandle handle)
+{
+	AssetRequest* r = asset_get_request(streamer, handle);
+	return r != NULL ? SDL_AtomicGet(&r->status) : AssetStatus_Failed;
+}
+
+static
+void asset_finalize_request(AssetStreamer* streamer, AssetRequest* r)
+{
+	if(SDL_AtomicGet(&r->status) != AssetStatus_Decoded) return;
+
+	if(r->kind == AssetKind_Texture) {
+		r->texture = ogl_add_texture(r->pixels, r->width, r->height);
+		STBI_FREE(r->pixels);
+		r->pixels = NULL;
+	}
+	SDL_AtomicSet(&r->status, AssetStatus_Ready);
+	if(r->on_ready != NULL) {
+		r->on_ready(r, r->userdata);
+	}
+}
+
+//Main thread only. Uploads decoded requests until budget_ms has passed;
+//always does at least one so a small budget can't stall loading entirely.
+//Returns the number of requests still in flight.
+i32 asset_streamer_finalize(AssetStreamer* streamer, f64 budget_ms)
+{
+	u64 start = SDL_GetPerformanceCounter();
+	u64 budget = (u64)(budget_ms / 1000.0 * SDL_GetPerformanceFrequency());
+	for(;;) {
+		SDL_LockMutex(streamer->lock);
+		i32 index = -1;
+		if(streamer->done_head != streamer->done_tail) {
+			index = streamer->done_queue[streamer->done_head++ % AssetStreamerMaxRequests];
+		}
+		SDL_UnlockMutex(streamer->lock);
+		if(index == -1) break;
+
+		asset_finalize_request(streamer, streamer->requests + index);
+		if(SDL_GetPerformanceCounter() - start > budget) break;
+	}
+
+	i32 pending = 0;
+	for(i32 i = 0; i < streamer->request_count; ++i) {
+		if(SDL_AtomicGet(&streamer->requests[i].status) < AssetStatus_Ready) pending++;
+	}
+	return pending;
+}
+
+//Blocks until one request is done, finalizing it early if it has to.
+//For things the first frame can't do without, like shader sources.
+AssetRequest* asset_stream_wait(AssetStreamer* streamer, AssetHandle handle)
+{
+	AssetRequest* r = asset_get_request(streamer, handle);
+	if(r == NULL) return NULL;
+	while(SDL_AtomicGet(&r->status) < AssetStatus_Decoded) {
+		if(!job_help(streamer->jobs)) {
+			SDL_Delay(0);
+		}
+	}
+	asset_finalize_request(streamer, r);
+	return SDL_AtomicGet(&r->status) == AssetStatus_Ready ? r : NULL;
+}
+
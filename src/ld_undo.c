@@ -0,0 +1,188 @@
+
+/* Undo
+ *
+ * An UndoStack is a stack of same sized items, kept in chunks pushed on an
+ * arena as it grows, so it never has to be copied, items never move, and it
+ * only runs out of room when the arena does. The live items are [base, top).
+ * Clearing just moves base up to top, so the old items are all still there
+ * to go back to.
+ *
+ * Every change, a push or a clear or a few of them, is followed by
+ * undo_commit, which puts what base and top were before and after into a
+ * ring of the last UndoHistorySize commits. Undoing and redoing only set
+ * base and top back, so they're O(1) however long the stack is. Nothing is
+ * ever written below top, and pushing throws away anything there was to
+ * redo, so every state still in the history still has its items.
+ *
+ * A checkpoint is a position in the history; undo_rewind jumps straight back
+ * (or forward) to it, as long as it hasn't fallen off the end of the ring.
+ */
+
+#define UndoHistorySize 4096
+
+typedef struct UndoCommit_
+{
+	isize before_base, before_top;
+	isize after_base, after_top;
+} UndoCommit;
+
+typedef struct UndoStack_
+{
+	MemoryArena* arena;
+	isize item_size;
+	//A power of two
+	isize chunk_items;
+	i32 chunk_shift;
+	u8** chunks;
+	i32 chunk_count;
+	i32 chunk_capacity;
+
+	isize base, top;
+	//base and top as of the last commit, undo or redo
+	isize committed_base, committed_top;
+
+	UndoCommit* history;
+	//Commits made so far; history holds [oldest, end), and position is
+	//where we are in that, less than end after undoing
+	u64 oldest, position, end;
+} UndoStack;
+
+//chunk_items is rounded up to a power of two
+void undo_stack_init(UndoStack* stack, MemoryArena* arena, isize item_size, isize chunk_items)
+{
+	memset(stack, 0, sizeof(UndoStack));
+	stack->arena = arena;
+	stack->item_size = item_size;
+	stack->chunk_items = 1;
+	while(stack->chunk_items < chunk_items) {
+		stack->chunk_items <<= 1;
+		stack->chunk_shift++;
+	}
+	stack->history = arena_push(arena, sizeof(UndoCommit) * UndoHistorySize);
+}
+
+//Any item pushed so far, by absolute index
+static inline
+void* undo_stack_get(UndoStack* stack, isize index)
+{
+	u8* chunk = stack->chunks[index >> stack->chunk_shift];
+	return chunk + (index & (stack->chunk_items - 1)) * stack->item_size;
+}
+
+static inline
+isize undo_stack_count(UndoStack* stack)
+{
+	return stack->top - stack->base;
+}
+
+//The live items, 0 being the bottom one
+static inline
+void* undo_stack_at(UndoStack* stack, isize index)
+{
+	return undo_stack_get(stack, stack->base + index);
+}
+
+//A zeroed slot on top, or NULL if the arena's full
+void* undo_stack_push(UndoStack* stack)
+{
+	isize chunk = stack->top >> stack->chunk_shift;
+	if(chunk >= stack->chunk_count) {
+		if(stack->chunk_count == stack->chunk_capacity) {
+			i32 capacity = stack->chunk_capacity > 0 ? stack->chunk_capacity * 2 : 16;
+			u8** chunks = arena_push(stack->arena, sizeof(u8*) * capacity);
+			if(chunks == NULL) return NULL;
+			if(stack->chunk_count > 0) {
+				memcpy(chunks, stack->chunks, sizeof(u8*) * stack->chunk_count);
+			}
+			stack->chunks = chunks;
+			stack->chunk_capacity = capacity;
+		}
+		u8* data = arena_push(stack->arena, stack->item_size * stack->chunk_items);
+		if(data == NULL) return NULL;
+		stack->chunks[stack->chunk_count++] = data;
+	}
+
+	stack->end = stack->position;
+	void* item = undo_stack_get(stack, stack->top++);
+	memset(item, 0, stack->item_size);
+	return item;
+}
+
+void undo_stack_clear(UndoStack* stack)
+{
+	stack->base = stack->top;
+}
+
+//Records everything since the last commit as one step to undo
+void undo_commit(UndoStack* stack)
+{
+	if(stack->base == stack->committed_base && stack->top == stack->committed_top) return;
+	if(stack->history == NULL) return;
+
+	UndoCommit* commit = stack->history + (stack->position % UndoHistorySize);
+	commit->before_base = stack->committed_base;
+	commit->before_top = stack->committed_top;
+	commit->after_base = stack->base;
+	commit->after_top = stack->top;
+	stack->end = ++stack->position;
+	if(stack->end - stack->oldest > UndoHistorySize) {
+		stack->oldest = stack->end - UndoHistorySize;
+	}
+	stack->committed_base = stack->base;
+	stack->committed_top = stack->top;
+}
+
+//Makes the stack as it is now the furthest back undo can go
+void undo_forget(UndoStack* stack)
+{
+	stack->oldest = stack->position = stack->end;
+	stack->committed_base = stack->base;
+	stack->committed_top = stack->top;
+}
+
+//To position, which has to be in [oldest, end]
+static
+void undo_set_position(UndoStack* stack, u64 position)
+{
+	if(position < stack->end) {
+		UndoCommit* commit = stack->history + (position % UndoHistorySize);
+		stack->base = commit->before_base;
+		stack->top = commit->before_top;
+	} else if(position > stack->oldest) {
+		UndoCommit* commit = stack->history + ((position - 1) % UndoHistorySize);
+		stack->base = commit->after_base;
+		stack->top = commit->after_top;
+	}
+	stack->position = position;
+	stack->committed_base = stack->base;
+	stack->committed_top = stack->top;
+}
+
+//Each returns false if there was nothing to do
+i32 undo(UndoStack* stack)
+{
+	if(stack->position <= stack->oldest) return false;
+	undo_set_position(stack, stack->position - 1);
+	return true;
+}
+
+i32 redo(UndoStack* stack)
+{
+	if(stack->position >= stack->end) return false;
+	undo_set_position(stack, stack->position + 1);
+	return true;
+}
+
+static inline
+u64 undo_checkpoint(UndoStack* stack)
+{
+	return stack->position;
+}
+
+i32 undo_rewind(UndoStack* stack, u64 checkpoint)
+{
+	if(checkpoint < stack->oldest || checkpoint > stack->end) return false;
+	undo_set_position(stack, checkpoint);
+	return true;
+}
+
@@ -25,3 +25,84 @@ void platform_decommit_memory(void* ptr, void* userdata)
 	VirtualFree(ptr, *(isize*)userdata, MEM_DECOMMIT);
 }
 
+
+void* platform_map_file(string name, isize* size_out)
+{
+	HANDLE file = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ, NULL, 
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == INVALID_HANDLE_VALUE) {
+		return NULL;
+	}
+
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		CloseHandle(file);
+		return NULL;
+	}
+
+	//The view keeps the mapping (and the file) alive, so both handles can go
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if(mapping == NULL) {
+		return NULL;
+	}
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+
+	if(data != NULL && size_out != NULL) {
+		*size_out = size.QuadPart;
+	}
+	return data;
+}
+
+void platform_unmap_file(void* ptr, isize size)
+{
+	UnmapViewOfFile(ptr);
+}
+
+#define PlatformMaxWatches 32
+
+struct PlatformWatcher_
+{
+	HANDLE handles[PlatformMaxWatches];
+	string dirs[PlatformMaxWatches];
+	i32 count;
+};
+
+PlatformWatcher* platform_watcher_create()
+{
+	return calloc(1, sizeof(PlatformWatcher));
+}
+
+i32 platform_watcher_add(PlatformWatcher* watcher, string dir)
+{
+	if(watcher->count >= PlatformMaxWatches) return false;
+	HANDLE handle = FindFirstChangeNotificationA(dir, FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE);
+	if(handle == INVALID_HANDLE_VALUE) {
+		log_error("Error: could not watch %s", dir);
+		return false;
+	}
+	watcher->handles[watcher->count] = handle;
+	watcher->dirs[watcher->count] = dir;
+	watcher->count++;
+	return true;
+}
+
+void platform_watcher_poll(PlatformWatcher* watcher, PlatformFileChangedProc proc, void* userdata)
+{
+	for(i32 i = 0; i < watcher->count; ++i) {
+		if(WaitForSingleObject(watcher->handles[i], 0) == WAIT_OBJECT_0) {
+			proc(watcher->dirs[i], NULL, userdata);
+			FindNextChangeNotification(watcher->handles[i]);
+		}
+	}
+}
+
+void platform_watcher_free(PlatformWatcher* watcher)
+{
+	for(i32 i = 0; i < watcher->count; ++i) {
+		FindCloseChangeNotification(watcher->handles[i]);
+	}
+	free(watcher);
+}
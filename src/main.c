@@ -36,13 +36,30 @@
 #endif
 
 #include "ld_math.c"
+#include "ld_batch.c"
 #include "ld_memory.c"
 #include "ld_random.c"
+#include "ld_jobs.c"
+#include "ld_sorting.c"
+#include "ld_broadphase.c"
+#include "ld_pathfind.c"
+#include "ld_undo.c"
+#include "ld_assets.c"
 
 #include "ld_renderer.c"
+#include "ld_entities.c"
+#include "ld_mixer.c"
 #include "ld_audio.c"
+#include "ld_streaming.c"
+#include "ld_input.c"
+#include "ld_profile.c"
+#include "ld_roomgen.c"
+#ifdef WB_DEBUG
+#include "ld_hotreload.c"
+#endif
 
 #include "ld_game.c"
+#include "ld_audiotools.c"
 
 Rect2 room_bg_texture = {{128, 0}, {640, 360}};
 
@@ -62,14 +79,11 @@ typedef enum RoomObjectKind_
 	RoomObjectKind_Count
 } RoomObjectKind;
 
-typedef struct RoomObject_
-{
-	RoomObjectKind kind;
-	Sprite sprite;
-	Vec2i gridpos;
-} RoomObject;
-
-RoomObject* objects_in_room;
+//One entity per cell, in cell order, so an entity is its cell's index too.
+//Empty cells have no sprite.
+EntityStore room_entities;
+//Each object's whole cell, for picking
+Broadphase room_broadphase;
 #define RoomObjectGridWidth 4
 #define RoomObjectGridHeight 3
 #define RoomObjectGridSize RoomObjectGridWidth * RoomObjectGridHeight
@@ -78,148 +92,230 @@ RoomObject* objects_in_room;
 #define StartingX 4
 #define StartingY 1
 
+//One of each kind, in kind order
+u8 room_kinds[RoomObjectKind_Count - 1];
+RoomGenConfig room_config;
+//What each cell costs to walk into, for checking and scoring the path
+i32 room_costs[RoomObjectGridSize];
+PathGrid room_grid;
+PathFinder room_pathfinder;
+
+void init_room_config(RoomGenConfig* config)
+{
+	for(i32 i = 1; i < RoomObjectKind_Count; ++i) {
+		room_kinds[i - 1] = i;
+	}
+	room_gen_config_init(config, RoomObjectGridWidth, RoomObjectGridHeight,
+			room_kinds, RoomObjectKind_Count - 1);
+	config->start = v2i(StartingX, StartingY);
+}
+
 void init_room_objects(GameHandle* game, u64 seed)
 {
 	//__debugbreak();
-	objects_in_room = arena_push(game->play_arena, sizeof(RoomObject) * RoomObjectGridSize);
-	RandomState random;
-	RandomState* r = &random;
-	randomstate_init(r, seed);
-	rand_xoroshift(r);
+	entity_store_init(&room_entities, game->play_arena, RoomObjectGridSize);
+	broadphase_init(&room_broadphase, game->play_arena, RoomObjectGridSize, RoomObjectGridSize * 4, RoomObjectCellX);
+
+	pathfinder_init(&room_pathfinder, game->play_arena, RoomObjectGridSize);
+
+	u8 kinds[RoomObjectGridSize];
+	RoomSummary summary;
+	room_generate(&room_config, seed, &room_pathfinder, kinds, &summary);
+	room_path_grid(&room_config, kinds, room_costs, &room_grid);
 
 	for(isize i = 0; i < RoomObjectGridSize; ++i) {
-		RoomObject* thing = objects_in_room + i;
-		thing->kind = RoomObject_Nothing;
+		u32 components = Component_Transform | Component_Cell | Component_Kind;
+		if(kinds[i] != RoomObject_Nothing) {
+			components |= Component_Sprite;
+		}
+		Entity e = entity_create(&room_entities, components);
 		isize x = i % RoomObjectGridWidth;
 		isize y = (i - x) / RoomObjectGridWidth;
-		thing->gridpos = v2i(x, y);
+		room_entities.kind[e] = kinds[i];
+		room_entities.cell[e] = v2i(x, y);
+		room_entities.pos[e] = v2(RoomObjectCellX * x + 64, RoomObjectCellY * y + 32);
+		room_entities.size[e] = v2(256, 256);
+		room_entities.texture[e] = rect2(0, 16 + (-1 + kinds[i]) * 128, 126, 126);
+		room_entities.sprite_flags[e] = Anchor_Top_Left;
+		Rect2 cell = rect2(
+				64 + RoomObjectCellX * x + RoomObjectCellX / 2, 
+				32 + RoomObjectCellY * y + RoomObjectCellY / 2,
+				RoomObjectCellX / 2, RoomObjectCellY / 2);
+		broadphase_insert(&room_broadphase, e, &cell);
 	}
-	
-	for(isize i = 1; i < RoomObjectKind_Count; ++i) {
-		RoomObject* thing = NULL;
-		usize index = 0; 
-		do {
-			index = rand_range_int(r, 0, RoomObjectGridSize);
-			if(objects_in_room[index].kind == RoomObject_Nothing) {
-				thing = objects_in_room + index;
-			}
+}
+
+#define RoomMineMaxCost 64
 
-		} while(!thing);
-		isize x = index % RoomObjectGridWidth;
-		isize y = (index - x) / RoomObjectGridWidth;
-		sprite_init(&thing->sprite);
-		thing->kind = i;
-		thing->sprite.size = v2(256, 256);
-		thing->sprite.texture = rect2(0, 16 + (-1 + thing->kind) * 128, 126, 126);
-		thing->sprite.pos = v2(RoomObjectCellX * x + 64, RoomObjectCellY * y + 32);
-		thing->sprite.flags = Anchor_Top_Left;
+//Generates count rooms from seed 1 up on every core, then prints how fast,
+//how many of each difficulty there were, and the first seed of each
+i32 mine_rooms(i32 count)
+{
+	MemoryArena* arena = arena_bootstrap("RoomMineArena",
+			sizeof(RoomSummary) * count + sizeof(Job) * JobDequeSize * JobMaxThreads
+			+ sizeof(RoomBatch) + pathfinder_size(RoomObjectGridSize) * JobMaxThreads);
+	RoomSummary* results = arena_push(arena, sizeof(RoomSummary) * count);
+	JobSystem jobs;
+	job_system_init(&jobs, 0, arena);
+
+	u64 start = SDL_GetPerformanceCounter();
+	room_generate_batch(&jobs, &room_config, arena, 1, count, results);
+	f64 seconds = (f64)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+	job_system_shutdown(&jobs);
+
+	i32 unsolvable = 0;
+	i32 histogram[RoomMineMaxCost + 1] = {0};
+	u64 first_seed[RoomMineMaxCost + 1] = {0};
+	for(i32 i = 0; i < count; ++i) {
+		RoomSummary* room = results + i;
+		if(!room->solvable) {
+			unsolvable++;
+			continue;
+		}
+		i32 cost = room->cost < RoomMineMaxCost ? room->cost : RoomMineMaxCost;
+		if(histogram[cost]++ == 0) first_seed[cost] = room->seed;
 	}
+
+	printf("%d rooms on %d threads in %.3fs, %.0f rooms/s, %d unsolvable\n",
+			count, jobs.thread_count, seconds, count / seconds, unsolvable);
+	printf("%10s %10s %12s\n", "difficulty", "rooms", "first seed");
+	for(i32 i = 0; i <= RoomMineMaxCost; ++i) {
+		if(histogram[i] == 0) continue;
+		printf("%9d%s %10d %12llu\n", i, i == RoomMineMaxCost ? "+" : " ",
+				histogram[i], (unsigned long long)first_seed[i]);
+	}
+	return 0;
+}
+
+//The first seed from seed on with a room of that difficulty, or 0
+u64 find_room_seed(u64 seed, i32 difficulty)
+{
+	MemoryArena* arena = arena_bootstrap("RoomSeedArena", pathfinder_size(RoomObjectGridSize));
+	PathFinder pf;
+	pathfinder_init(&pf, arena, RoomObjectGridSize);
+	u8 kinds[RoomObjectGridSize];
+	RoomSummary summary;
+	u64 found = 0;
+	for(i32 i = 0; i < 1000000; ++i) {
+		if(room_generate(&room_config, seed + i, &pf, kinds, &summary) && summary.cost == difficulty) {
+			found = seed + i;
+			break;
+		}
+	}
+	arena_free(arena);
+	return found;
 }
 
 typedef struct PathNode_
 {
 	i32 is_path_start;
-	Vec2i start, end;
-	RoomObject* thing_start;
-	RoomObject* thing_end;
+	//The path goes from each node's cell to the next one's
+	Vec2i start;
+	Entity thing_start;
 	i32 scavenge_at_end;
+	//Of stepping into start
 	i32 cost;
 } PathNode;
 
-PathNode nodes[1024];
-i32 node_count;
+//Of PathNodes; Ctrl+Z and Ctrl+Y walk its history
+UndoStack path;
+#define PathChunkNodes 256
 
 
 void node_init(PathNode* node)
 {
 	node->is_path_start = 0;
 	node->start = v2i(0, 0);;
-	node->end = v2i(0, 0);
-	node->thing_start = NULL;
-	node->thing_end = NULL;
+	node->thing_start = EntityNone;
 	node->scavenge_at_end = 0;
 	node->cost = 0;
 }
 
 void clear_path()
 {
-	node_count = 1;
-	nodes[0].is_path_start = true;
-	nodes[0].start = v2i(StartingX, StartingY);
+	undo_stack_clear(&path);
+	PathNode* node = undo_stack_push(&path);
+	if(node == NULL) return;
+	node_init(node);
+	node->is_path_start = true;
+	node->start = v2i(StartingX, StartingY);
+	undo_commit(&path);
 }
 
+void init_path(GameHandle* game)
+{
+	undo_stack_init(&path, game->play_arena, sizeof(PathNode), PathChunkNodes);
+	clear_path();
+	//There's always a start to go back to
+	undo_forget(&path);
+}
+
+
 
 
+#define HoverSpeed 12.0f
+#define HoverScale 1.2f
+
+void update(GameHandle* game, f32 dt)
+{
+	int mx = game->input->mouse.x;
+	int my = game->input->mouse.y;
+	int just_pressed = input_mouse_pressed(game->input, SDL_BUTTON_LEFT);
+
+	//On an edge between cells the later one wins, like dividing used to
+	i32 hits[4];
+	i32 hit_count = broadphase_query_point(&room_broadphase, v2(mx, my), hits, 4);
+	int mi = -1;
+	for(i32 i = 0; i < hit_count; ++i) {
+		if(hits[i] > mi) mi = hits[i];
+	}
+
+	f32 ease = HoverSpeed * dt;
+	if(ease > 1) ease = 1;
+	entity_ease_scales(&room_entities, mi, HoverScale, ease);
+
+	if(mi != -1 && just_pressed) {
+		Vec2i cell = room_entities.cell[mi];
+		PathNode* current_node = undo_stack_at(&path, undo_stack_count(&path) - 1);
+		if(path_step_valid(&room_grid, current_node->start, cell)) {
+			PathNode* node = undo_stack_push(&path);
+			if(node != NULL) {
+				node_init(node);
+				node->start = cell;
+				node->thing_start = mi;
+				node->cost = room_costs[cell.y * RoomObjectGridWidth + cell.x];
+				undo_commit(&path);
+			}
+		}
+	}
 
-int last_mouse_state = 0;
+	if(input_key_down(game->input, SDL_SCANCODE_LCTRL)) {
+		if(input_key_pressed(game->input, SDL_SCANCODE_Z)) {
+			undo(&path);
+		} else if(input_key_pressed(game->input, SDL_SCANCODE_Y)) {
+			redo(&path);
+		}
+	} else if(input_key_pressed(game->input, SDL_SCANCODE_BACKSPACE) && undo_stack_count(&path) > 1) {
+		clear_path();
+	}
+}
 
-void update(GameHandle* game)
+//alpha is how far we are between the last tick and the next one
+void draw(GameHandle* game, f32 alpha)
 {
 	//printf("err: %d\n", glGetError());
 	render_start(game->current_group);
 
-
 	Sprite s;
 	sprite_init(&s);
 
-	int mx, my;
-	int btn = SDL_GetMouseState(&mx, &my) & SDL_BUTTON(SDL_BUTTON_LEFT);
-	int just_pressed = btn && btn != last_mouse_state;
-	//printf("%d %d\n", mx, my);
-
 	s.pos = v2(0, 0);
 	s.texture = room_bg_texture;
 	s.size = v2(1280, 720);
 	s.flags = Anchor_Top_Left; 
 	render_add(game->current_group, &s);
 
-	int tx = mx - 64;
-	tx /= RoomObjectCellX;
-	int ty = my - 32;
-	ty /= RoomObjectCellY;
-
-	int mi = ty * RoomObjectGridWidth + tx;
-	if(mx < 64 || mx > 1280 - 64) {
-		mi = -1;
-	}
-	
-	if(my < 32 || my > 720 - 32) {
-		mi = -1;
-	}
-
-
-	for(isize i = 0; i < RoomObjectGridSize; ++i) {
-		RoomObject* thing = objects_in_room + i;
-		s = thing->sprite;
-		if(i == mi) {
-			s.pos.x += s.size.x / 2;
-			s.pos.y += s.size.y / 2;
-			s.size = v2_scale(&s.size, 1.2);
-			s.flags = Anchor_Center;
-
-			if(just_pressed) {
-				PathNode* current_node = nodes + (node_count-1);
-				i32 dx = (current_node->start.x - thing->gridpos.x);
-				i32 dy = (current_node->start.y - thing->gridpos.y);
-				printf("%d %d\n", dx, dy);
-
-				dx = abs(dx);
-				dy = abs(dy);
-				
-				if((dx * dy == 0) && dx <= 1 && dy <= 1) {
-					current_node->end = thing->gridpos;
-					current_node->thing_end = thing;
-					node_count++;
-					current_node = nodes + node_count-1;
-					node_init(current_node);
-					current_node->start = thing->gridpos;
-					current_node->thing_start = thing;
-				}
-			}
-			
-		}
-		render_add(game->current_group, &s);
-	}
+	entity_render_sprites(&room_entities, game->current_group, alpha);
 	
 	i32 xoffset = 64 + 128;
 	i32 yoffset = 32 + 128;
@@ -238,30 +334,21 @@ void update(GameHandle* game)
 	s.color = create_color(0, 0, 0, 0.5);
 	s.flags = Anchor_Top_Left; 
 	render_add(game->current_group, &s);
-	
-
-	if(game->keys[SDL_SCANCODE_LCTRL] >= Button_Pressed && game->keys[SDL_SCANCODE_Z] == Button_JustPressed) {
-		node_count--;
-		nodes[node_count-1].thing_end = NULL;
-		if(node_count < 1) {
-			clear_path();
-		}
-	}
-
-
 
+	isize node_count = undo_stack_count(&path);
 	for(isize i = 0; i < node_count; ++i) {
-		PathNode* node = nodes + i;
+		PathNode* node = undo_stack_at(&path, i);
 		Vec2 start;
 		start.x = node->start.x * RoomObjectCellX + xoffset;
 		start.y = node->start.y * RoomObjectCellY + yoffset;
 		if(node->is_path_start) {
 			start.x = 1280 - 48;
 		}
-		if(node->thing_end != NULL) {
+		if(i + 1 < node_count) {
+			PathNode* next = undo_stack_at(&path, i + 1);
 			Vec2 end;
-			end.x = node->end.x * RoomObjectCellX + xoffset;
-			end.y = node->end.y * RoomObjectCellY + yoffset;
+			end.x = next->start.x * RoomObjectCellX + xoffset;
+			end.y = next->start.y * RoomObjectCellY + yoffset;
 			render_line(game->current_group, start, end, create_color(1, 1, 1, 0.2), 8);
 		}
 
@@ -275,12 +362,8 @@ void update(GameHandle* game)
 		render_add(game->current_group, &s);
 	}
 
-
-
-
 	game_set_scale(game, 1.0);
 	render_draw(game->renderer, game->current_group, game->display_size, game->scale);
-	last_mouse_state = btn;
 }
 
 
@@ -292,25 +375,83 @@ int main(int argc, char** argv)
 	settings.window_title = "William's Ludum Dare 37 Entry";
 	settings.window_size = v2i(1280, 720);
 	settings.display_scale = 1.0f;
-	settings.archive_name = "assets.zip";
+	settings.archive_name = "assets.pak";
 	settings.vert_shader = "src/shaders/vert.glsl";
 	settings.frag_shader = "src/shaders/frag.glsl";
 	settings.texture_file = "assets/graphics.png";
+	//Any .ogg, .flac or .wav packed from assets/
+	settings.music_file = NULL;
+	//Sound effects, played with play_sound(index, ...)
+	settings.sound_files = NULL;
+	settings.sound_count = 0;
+	settings.asset_budget_ms = 2.0f;
+	settings.tick_rate = 60.0f;
+	settings.vsync = true;
+	//Only used when vsync is off or unavailable; 0 then means the refresh rate
+	settings.frame_limit = 0;
+	settings.seed = 2;
 #ifdef WB_DEBUG
 	settings.display_index = 1;
 #else
 	settings.display_index = 0;
 #endif
 
+	init_room_config(&room_config);
+	i32 difficulty = -1;
+	for(i32 i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if(strcmp(arg, "--render-audio") == 0 && i + 2 < argc) {
+			return audio_render_offline(&settings, argv[i + 1], argv[i + 2]);
+		} else if(strcmp(arg, "--bench-mixer") == 0) {
+			return audio_bench_mixer();
+		} else if(strcmp(arg, "--record") == 0 && i + 1 < argc) {
+			settings.record_input = argv[++i];
+		} else if(strcmp(arg, "--replay") == 0 && i + 1 < argc) {
+			settings.replay_input = argv[++i];
+		} else if(strcmp(arg, "--bench") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+			settings.bench_frames = atoi(argv[++i]);
+		} else if(strcmp(arg, "--hidden") == 0) {
+			settings.bench_hidden = true;
+		} else if(strcmp(arg, "--seed") == 0 && i + 1 < argc) {
+			settings.seed = strtoull(argv[++i], NULL, 10);
+		} else if(strcmp(arg, "--difficulty") == 0 && i + 1 < argc) {
+			difficulty = atoi(argv[++i]);
+		} else if(strcmp(arg, "--mine-rooms") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+			return mine_rooms(atoi(argv[i + 1]));
+		} else {
+			printf("Usage: %s [options]\n"
+					"  --render-audio <cues> <out.wav>  mix a cue file to a wav, no sound device\n"
+					"  --bench-mixer                    time the mixer at 8/32/128 voices\n"
+					"  --record <file>                  log this session's events and seed to a file\n"
+					"  --replay <file>                  replay a log as fast as possible, then quit\n"
+					"  --bench <frames>                 run uncapped for that many frames and print timings\n"
+					"  --hidden                         with --bench, draw offscreen behind a hidden window\n"
+					"  --seed <n>                       the room's seed (default 2)\n"
+					"  --difficulty <n>                 the first room from the seed on that's that hard\n"
+					"  --mine-rooms <count>             generate rooms from seed 1 up and print their difficulties\n",
+					argv[0]);
+			return 1;
+		}
+	}
+
+	if(difficulty >= 0) {
+		u64 seed = find_room_seed(settings.seed, difficulty);
+		if(seed == 0) {
+			log_error("Error: no room of difficulty %d near seed %llu", difficulty, (unsigned long long)settings.seed);
+			return 1;
+		}
+		settings.seed = seed;
+	}
+
 	//game initializaiton
 	GameHandle* game = game_init(&settings);
 	if(game == NULL) return 1;
 
 
-	init_room_objects(game, 2);
-	clear_path();
+	init_room_objects(game, game->seed);
+	init_path(game);
 
 
-	game_start(game, &update);
+	game_start(game, &update, &draw);
 	return 0;
 }
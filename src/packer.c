@@ -0,0 +1,191 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+/* Builds the asset pack read by ld_assets.c
+ *
+ * usage: packer <output> <files...>
+ *
+ * Asset names are the paths as given, with '\' turned into '/',
+ * so "src\shaders\vert.glsl" is looked up as "src/shaders/vert.glsl"
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define log_error(fmt, ...) do { \
+	char buf[4096]; \
+	snprintf(buf, 4096, fmt, __VA_ARGS__); \
+	fprintf(stderr, "%s \n", buf); \
+} while(0)
+
+#define wb_assert(condition, msg, ...)
+
+#include "thirdparty/miniz.c"
+#include "ld_platform.h"
+
+#ifdef WB_WINDOWS
+#include "ld_win32.c"
+#endif
+
+#ifdef WB_LINUX
+#include "ld_linux.c"
+#endif
+
+#include "ld_memory.c"
+#define WB_PACKER
+#include "ld_assets.c"
+
+//Only keep the deflated version if it saves at least 1/8th of the file;
+//otherwise the inflate at load time costs more than the bytes it saves
+#define PackerMinSavingsShift 3
+
+typedef struct PackerFile_
+{
+	char* name;
+	u8* data;
+	isize size;
+	u8* stored;
+	isize stored_size;
+	u64 hash;
+	i32 compressed;
+} PackerFile;
+
+static
+void packer_write_zeros(FILE* fp, isize count)
+{
+	u8 zeros[AssetPackAlignment] = {0};
+	while(count > 0) {
+		isize n = count > AssetPackAlignment ? AssetPackAlignment : count;
+		fwrite(zeros, 1, n, fp);
+		count -= n;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if(argc < 3) {
+		fprintf(stderr, "usage: %s <output> <files...>\n", argv[0]);
+		return 1;
+	}
+
+	Allocator alloc = allocator_create(platform_malloc_wrapper, platform_free_wrapper, NULL, NULL);
+	isize file_count = argc - 2;
+	PackerFile* files = calloc(file_count, sizeof(PackerFile));
+	isize count = 0;
+
+	for(isize i = 0; i < file_count; ++i) {
+		PackerFile* file = files + count;
+		file->name = argv[i + 2];
+		for(char* c = file->name; *c; ++c) {
+			if(*c == '\\') *c = '/';
+		}
+		file->hash = hash_string(file->name);
+
+		i32 duplicate = false;
+		for(isize j = 0; j < count; ++j) {
+			if(strcmp(files[j].name, file->name) == 0) duplicate = true;
+		}
+		if(duplicate) {
+			log_error("Warning: %s given twice, skipping", file->name);
+			continue;
+		}
+
+		file->data = (u8*)platform_read_file(file->name, &file->size, alloc);
+		if(file->data == NULL) {
+			return 1;
+		}
+
+		file->stored = file->data;
+		file->stored_size = file->size;
+		usize deflated_size = 0;
+		u8* deflated = tdefl_compress_mem_to_heap(file->data, file->size, &deflated_size,
+				TDEFL_WRITE_ZLIB_HEADER | TDEFL_DEFAULT_MAX_PROBES);
+		if(deflated != NULL &&
+				(isize)deflated_size <= file->size - (file->size >> PackerMinSavingsShift)) {
+			file->stored = deflated;
+			file->stored_size = deflated_size;
+			file->compressed = true;
+		} else if(deflated != NULL) {
+			mz_free(deflated);
+		}
+		count++;
+	}
+
+	u32 slot_count = 1;
+	while(slot_count < count * 2) slot_count <<= 1;
+
+	AssetPackHeader header = {0};
+	header.magic = AssetPackMagic;
+	header.version = AssetPackVersion;
+	header.entry_count = count;
+	header.slot_count = slot_count;
+	header.slots_offset = sizeof(AssetPackHeader);
+	header.entries_offset = header.slots_offset + sizeof(u32) * slot_count;
+	header.names_offset = header.entries_offset + sizeof(AssetPackEntry) * count;
+
+	u32* slots = calloc(slot_count, sizeof(u32));
+	AssetPackEntry* entries = calloc(count, sizeof(AssetPackEntry));
+
+	u32 names_size = 0;
+	for(isize i = 0; i < count; ++i) {
+		names_size += strlen(files[i].name) + 1;
+	}
+	header.data_offset = mem_align(header.names_offset + names_size, AssetPackAlignment);
+
+	u64 offset = header.data_offset;
+	u32 name_offset = 0;
+	for(isize i = 0; i < count; ++i) {
+		PackerFile* file = files + i;
+		AssetPackEntry* entry = entries + i;
+		entry->hash = file->hash;
+		entry->offset = offset;
+		entry->size = file->size;
+		entry->stored_size = file->stored_size;
+		entry->name_offset = name_offset;
+		entry->flags = file->compressed ? AssetFlag_Compressed : 0;
+		name_offset += strlen(file->name) + 1;
+		offset = mem_align(offset + file->stored_size + 1, AssetPackAlignment);
+
+		u32 slot = (u32)file->hash & (slot_count - 1);
+		while(slots[slot] != 0) {
+			slot = (slot + 1) & (slot_count - 1);
+		}
+		slots[slot] = i + 1;
+	}
+
+	FILE* fp = fopen(argv[1], "wb");
+	if(fp == NULL) {
+		log_error("Error: could not open %s for writing", argv[1]);
+		return 1;
+	}
+
+	fwrite(&header, sizeof(AssetPackHeader), 1, fp);
+	fwrite(slots, sizeof(u32), slot_count, fp);
+	fwrite(entries, sizeof(AssetPackEntry), count, fp);
+	for(isize i = 0; i < count; ++i) {
+		fwrite(files[i].name, 1, strlen(files[i].name) + 1, fp);
+	}
+	packer_write_zeros(fp, header.data_offset - (header.names_offset + names_size));
+
+	isize stored_total = 0, raw_total = 0;
+	for(isize i = 0; i < count; ++i) {
+		PackerFile* file = files + i;
+		AssetPackEntry* entry = entries + i;
+		fwrite(file->stored, 1, file->stored_size, fp);
+		isize end = entry->offset + file->stored_size;
+		isize next = i + 1 < count ? entries[i + 1].offset : mem_align(end + 1, AssetPackAlignment);
+		packer_write_zeros(fp, next - end);
+
+		printf("%-40s %8d -> %8d %s\n", file->name, (i32)file->size, (i32)file->stored_size,
+				file->compressed ? "deflate" : "stored");
+		raw_total += file->size;
+		stored_total += file->stored_size;
+	}
+	fclose(fp);
+
+	printf("Packed %d assets into %s (%d -> %d bytes)\n", (i32)count, argv[1],
+			(i32)raw_total, (i32)stored_total);
+	return 0;
+}
@@ -16,9 +16,6 @@
 #define STB_VORBIS_HEADER_ONLY
 #include "thirdparty/stb_vorbis.c"
 
-#define STS_MIXER_IMPLEMENTATION
-#include "thirdparty/sts_mixer.h"
-
 #define DR_FLAC_IMPLEMENTATION
 #include "thirdparty/dr_flac.h"
 